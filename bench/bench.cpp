@@ -0,0 +1,915 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <array>
+#include <mutex>
+#include <cstdio>
+#include <filesystem>
+#include <tuple>
+#include <unistd.h>
+#include <fcntl.h>
+#include <fstream>
+#include <random>
+
+#include "../include/npc.h"
+#include "../include/game_utils.h"
+#include "../include/spatial_grid.h"
+#include "../include/simd_kernels.h"
+#include "../include/checkpoint.h"
+#include "../include/engine.h"
+#include "../include/worker_pool.h"
+#include "../include/rng.h"
+#include "../include/alloc_stats.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static std::vector<std::shared_ptr<NPC>> make_population(size_t n, int side) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        npcs.push_back(createNPC(random_type(), uint32_t(i),
+                                 random_coord(0, side), random_coord(0, side)));
+    return npcs;
+}
+
+// ======================================================
+// Пространственный индекс: пары за тик
+// ======================================================
+static void bench_spatial_case(size_t n, int side) {
+    auto npcs = make_population(n, side);
+
+    SpatialGrid grid(side, side);
+    for (auto &npc : npcs) grid.insert(npc);
+
+    size_t in_range = 0;
+    auto t0 = Clock::now();
+    size_t examined = grid.for_each_candidate_pair([&](const auto &, const auto &) { ++in_range; });
+    double ms = ms_since(t0);
+
+    double all_pairs = static_cast<double>(n) * (n - 1) / 2;
+    std::cout << std::left
+              << std::setw(10) << n
+              << std::setw(8) << side
+              << std::setw(16) << std::fixed << std::setprecision(0) << all_pairs
+              << std::setw(14) << examined
+              << std::setw(14) << in_range
+              << std::setprecision(2) << ms << " ms\n";
+}
+
+static void bench_spatial() {
+    std::cout << "\n=== SpatialGrid: pairs per tick ===\n";
+    std::cout << std::left
+              << std::setw(10) << "NPCs"
+              << std::setw(8) << "Map"
+              << std::setw(16) << "All pairs"
+              << std::setw(14) << "Examined"
+              << std::setw(14) << "In range"
+              << "Time\n";
+
+    // плотность как в main.cpp: 50 NPC на карте MAP_X x MAP_Y
+    for (size_t n : {1000u, 10000u, 100000u}) {
+        int side = static_cast<int>(MAP_X * std::sqrt(n / 50.0));
+        bench_spatial_case(n, side);
+    }
+
+    // фиксированная карта: стоимость растёт только с локальной плотностью
+    for (size_t n : {1000u, 10000u, 100000u})
+        bench_spatial_case(n, MAP_X);
+}
+
+// ======================================================
+// InteractionManager: пропускная способность и задержка
+// ======================================================
+struct StampObserver : public IInteractionObserver {
+    std::vector<Clock::time_point> stamps;
+    std::atomic<size_t> count{0};
+
+    explicit StampObserver(size_t n) : stamps(n) {}
+
+    void on_interaction(const NPC &, const NPC &, InteractionOutcome) override {
+        size_t i = count.fetch_add(1);
+        if (i < stamps.size()) stamps[i] = Clock::now();
+    }
+};
+
+// Орк против медведя в одной точке даёт ровно одно уведомление на событие,
+// а очередь FIFO, поэтому k-е уведомление относится к k-му событию.
+static void bench_interaction_run(const char *label, size_t n, std::chrono::microseconds pace) {
+    auto obs = std::make_shared<StampObserver>(n);
+    std::vector<std::shared_ptr<NPC>> npcs;
+    std::vector<InteractionEvent> events;
+    npcs.reserve(2 * n);
+    events.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto o = createNPC(NPCType::Orc, "O", 0, 0);
+        auto b = createNPC(NPCType::Bear, "B", 0, 0);
+        o->subscribe(obs);
+        events.push_back({o, b});
+        npcs.push_back(std::move(o));
+        npcs.push_back(std::move(b));
+    }
+
+    std::vector<Clock::time_point> pushed(n);
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        if (pace.count()) std::this_thread::sleep_until(t0 + pace * i);
+        pushed[i] = Clock::now();
+        InteractionManager::instance().push(events[i]);
+    }
+    while (obs->count < n) std::this_thread::sleep_for(std::chrono::microseconds(100));
+    double total_ms = ms_since(t0);
+
+    std::vector<double> lat(n);
+    for (size_t i = 0; i < n; ++i)
+        lat[i] = std::chrono::duration<double, std::milli>(obs->stamps[i] - pushed[i]).count();
+    std::sort(lat.begin(), lat.end());
+
+    std::cout << std::left << std::setw(10) << label
+              << std::setw(10) << n
+              << std::setw(14) << std::fixed << std::setprecision(0) << n / (total_ms / 1000)
+              << std::setprecision(3)
+              << std::setw(12) << lat[n / 2]
+              << lat[n * 99 / 100] << "\n";
+}
+
+static void bench_interaction() {
+    std::cout << "\n=== InteractionManager: events/s, enqueue-to-resolve latency (ms) ===\n";
+    std::cout << std::left << std::setw(10) << "Mode"
+              << std::setw(10) << "Events"
+              << std::setw(14) << "Events/s"
+              << std::setw(12) << "p50"
+              << "p99\n";
+
+    // без потерь: каждое событие должно дойти до наблюдателя
+    InteractionManager::instance().configure(1 << 12, OverflowPolicy::BlockProducer);
+    std::thread worker(std::ref(InteractionManager::instance()));
+    bench_interaction_run("burst", 100000, std::chrono::microseconds(0));
+    bench_interaction_run("paced", 2000, std::chrono::microseconds(500));
+    InteractionManager::instance().stop();
+    worker.join();
+}
+
+// ======================================================
+// Параллельное разрешение взаимодействий
+// ======================================================
+static void bench_resolver() {
+    constexpr size_t N = 100000;
+    int side = static_cast<int>(MAP_X * std::sqrt(N / 50.0));
+    auto npcs = make_population(N, side);
+
+    SpatialGrid grid(side, side);
+    for (auto &npc : npcs) grid.insert(npc);
+
+    std::vector<InteractionEvent> events;
+    grid.for_each_candidate_pair([&](const auto &a, const auto &b) {
+        events.push_back({a->handle, b->handle});
+    });
+
+    auto &im = InteractionManager::instance();
+    im.configure(events.size(), OverflowPolicy::BlockProducer);
+
+    std::cout << "\n=== Resolver: " << N << " NPCs, " << events.size() << " events per tick ===\n";
+    std::cout << std::left << std::setw(10) << "Workers"
+              << std::setw(14) << "Time ms"
+              << std::setw(14) << "Events/s"
+              << "Speedup\n";
+
+    size_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+    double base = 0;
+    for (size_t w = 1; w <= max_workers; w *= 2) {
+        for (auto &npc : npcs) npc->heal();
+        for (auto &ev : events) im.push(ev);
+
+        im.set_workers(w);
+        auto t0 = Clock::now();
+        while (im.drain() > 0) {}
+        double ms = ms_since(t0);
+        if (w == 1) base = ms;
+
+        std::cout << std::left << std::setw(10) << w
+                  << std::setw(14) << std::fixed << std::setprecision(2) << ms
+                  << std::setw(14) << std::setprecision(0) << events.size() / (ms / 1000)
+                  << std::setprecision(2) << base / ms << "x\n";
+    }
+    im.set_workers(1);
+}
+
+// ======================================================
+// Передача событий: shared_ptr против дескрипторов
+// ======================================================
+// Прежний путь события, воспроизведённый по шагам: пара shared_ptr
+// копируется в очередь, каждый из четырёх посетителей держит свою копию,
+// а уведомление заворачивает this в shared_ptr с новым блоком управления.
+// Атомарные RMW на событие: 2 (копия в очередь) + 8 (посетители)
+// + 2 (снятие события) = 12, и ещё инкремент, декремент и выделение
+// памяти на каждого наблюдателя. Путь через дескрипторы - две проверки
+// поколения в NPCWorld и ссылки, без атомарных RMW.
+struct LegacyEvent {
+    std::shared_ptr<NPC> actor;
+    std::shared_ptr<NPC> target;
+};
+
+static uint64_t legacy_pass(const LegacyEvent &ev) {
+    LegacyEvent queued = ev;
+    LegacyEvent popped = std::move(queued);
+    uint64_t sum = 0;
+    for (int k = 0; k < 4; ++k) {
+        std::shared_ptr<NPC> held = k % 2 ? popped.target : popped.actor;
+        sum += held->position().first;
+    }
+    std::shared_ptr<NPC> self(popped.actor.get(), [](NPC *) {});
+    return sum + self->position().second + popped.target->position().second;
+}
+
+static uint64_t handle_pass(const InteractionEvent &ev) {
+    auto &world = NPCWorld::instance();
+    InteractionEvent popped = ev;
+    NPC *a = world.get(popped.actor);
+    NPC *t = world.get(popped.target);
+    if (!a || !t) return 0;
+    uint64_t sum = 0;
+    for (int k = 0; k < 4; ++k) {
+        const NPC &held = k % 2 ? *t : *a;
+        sum += held.position().first;
+    }
+    return sum + a->position().second + t->position().second;
+}
+
+static void bench_plumbing() {
+    constexpr size_t N = 100000;
+    constexpr int ROUNDS = 20;
+    int side = static_cast<int>(MAP_X * std::sqrt(N / 50.0));
+    auto npcs = make_population(N, side);
+
+    SpatialGrid grid(side, side);
+    for (auto &npc : npcs) grid.insert(npc);
+
+    std::vector<LegacyEvent> legacy;
+    std::vector<InteractionEvent> events;
+    grid.for_each_candidate_pair([&](const auto &a, const auto &b) {
+        legacy.push_back({a, b});
+        events.push_back({a->handle, b->handle});
+    });
+
+    std::cout << "\n=== Event plumbing: " << events.size() << " events x " << ROUNDS << " ===\n";
+    std::cout << std::left << std::setw(10) << "path" << std::setw(14) << "bytes/event"
+              << std::setw(14) << "RMW/event" << "ns/event\n";
+
+    volatile uint64_t sink = 0;
+    auto t0 = Clock::now();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (auto &ev : legacy) sink = sink + legacy_pass(ev);
+    double legacy_ns = ms_since(t0) * 1e6 / (double(legacy.size()) * ROUNDS);
+
+    t0 = Clock::now();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (auto &ev : events) sink = sink + handle_pass(ev);
+    double handle_ns = ms_since(t0) * 1e6 / (double(events.size()) * ROUNDS);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(10) << "shared" << std::setw(14) << sizeof(LegacyEvent)
+              << std::setw(14) << "14 + alloc" << legacy_ns << "\n"
+              << std::setw(10) << "handle" << std::setw(14) << sizeof(InteractionEvent)
+              << std::setw(14) << 0 << handle_ns << "\n" << std::defaultfloat;
+}
+
+// ======================================================
+// Пакетные ядра
+// ======================================================
+static void bench_simd() {
+    constexpr size_t N = 1 << 16;
+    constexpr int ROUNDS = 200;
+    std::vector<int> x(N), y(N), dx(N), dy(N), r(N);
+    std::vector<uint64_t> state(N);
+    for (size_t k = 0; k < N; ++k) {
+        x[k] = random_coord(0, MAP_X);
+        y[k] = random_coord(0, MAP_Y);
+        dx[k] = random_coord(-20, 20);
+        dy[k] = random_coord(-20, 20);
+        r[k] = interaction_distance(random_type());
+        state[k] = NPCState::pack(x[k], y[k], true);
+    }
+    std::vector<uint8_t> mask(N);
+
+    std::cout << "\n=== Kernels: " << N << " NPCs x " << ROUNDS << " rounds ===\n";
+    std::cout << std::left << std::setw(10) << "Level"
+              << std::setw(18) << "move NPCs/s"
+              << "range NPCs/s\n";
+
+    SimdLevel native = simd_level();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2}) {
+        force_simd_level(level);
+        if (simd_level() != level) continue;
+
+        auto t0 = Clock::now();
+        for (int k = 0; k < ROUNDS; ++k)
+            move_batch(state.data(), state.data(), dx.data(), dy.data(), N, MAP_X, MAP_Y);
+        double move_ms = ms_since(t0);
+
+        t0 = Clock::now();
+        for (int k = 0; k < ROUNDS; ++k)
+            range_mask(k % MAP_X, k % MAP_Y, 10, x.data(), y.data(), r.data(), N, mask.data());
+        double range_ms = ms_since(t0);
+
+        std::cout << std::left << std::setw(10) << simd_level_name(level)
+                  << std::setw(18) << std::scientific << std::setprecision(2) << N * ROUNDS / (move_ms / 1000)
+                  << N * ROUNDS / (range_ms / 1000) << "\n";
+    }
+    force_simd_level(native);
+    std::cout << std::defaultfloat;
+}
+
+// ======================================================
+// Журнал взаимодействий: цена события и объём
+// ======================================================
+template <typename Observer>
+static void observer_run(const char *label, const std::string &fname) {
+    constexpr size_t N = 100000;
+    constexpr auto PACE = std::chrono::nanoseconds(10000); // 100k событий/с
+
+    auto obs = Observer::get(fname);
+    auto a = createNPC(NPCType::Orc, "Orc_1", 10, 20);
+    auto b = createNPC(NPCType::Bear, "Bear_2", 12, 21);
+
+    double busy_ns = 0;
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < N; ++i) {
+        while (Clock::now() < t0 + PACE * i) {}
+        auto s = Clock::now();
+        obs->on_interaction(*a, *b, i % 2 ? InteractionOutcome::TargetKilled : InteractionOutcome::TargetEscaped);
+        busy_ns += std::chrono::duration<double, std::nano>(Clock::now() - s).count();
+    }
+    double total_ms = ms_since(t0);
+    static_cast<Observer&>(*obs).flush();
+
+    std::error_code ec;
+    auto bytes = std::filesystem::file_size(fname, ec);
+
+    std::cout << std::left << std::setw(8) << label << std::fixed << std::setprecision(0)
+              << std::setw(14) << N / (total_ms / 1000)
+              << std::setw(14) << busy_ns / N
+              << std::setprecision(1) << double(bytes) / N << "\n";
+    std::cout << std::defaultfloat;
+    std::remove(fname.c_str());
+}
+
+static void bench_observer() {
+    std::cout << "\n=== Interaction log: 100000 events at 100k/s ===\n";
+    std::cout << std::left << std::setw(8) << "format" << std::setw(14) << "events/s"
+              << std::setw(14) << "ns/event" << "bytes/event\n";
+    observer_run<FileObserver>("text", "bench_log.txt");
+    observer_run<BinaryFileObserver>("binary", "bench_log.bin");
+}
+
+// ======================================================
+// Наблюдатели: подписка на каждого NPC против шины событий
+// ======================================================
+static void bench_bus() {
+    constexpr size_t N = 100000;
+    constexpr size_t EVENTS = 500000;
+    constexpr size_t PER_TICK = 2000;
+    const std::string fname = "bench_log.bin";
+
+    auto npcs = make_population(N, 10000);
+    auto obs = BinaryFileObserver::get(fname);
+    auto event = [&](size_t i) -> std::pair<NPC&, NPC&> {
+        return {*npcs[i % N], *npcs[(i * 7 + 1) % N]};
+    };
+
+    std::cout << "\n=== Observers: " << N << " NPCs, " << EVENTS << " outcomes, "
+              << PER_TICK << " per tick ===\n";
+    std::cout << std::left << std::setw(10) << "path" << std::setw(16) << "subscribe ms"
+              << "ns/event\n";
+
+    auto t0 = Clock::now();
+    for (auto &npc : npcs) npc->subscribe(obs);
+    double sub_ms = ms_since(t0);
+    t0 = Clock::now();
+    for (size_t i = 0; i < EVENTS; ++i) {
+        auto [a, t] = event(i);
+        a.notify_interaction(t, InteractionOutcome::TargetEscaped);
+    }
+    double per_npc_ns = ms_since(t0) * 1e6 / EVENTS;
+
+    auto &bus = EventBus::instance();
+    t0 = Clock::now();
+    auto token = bus.subscribe(obs);
+    double bus_sub_ms = ms_since(t0);
+    t0 = Clock::now();
+    for (size_t i = 0; i < EVENTS; ++i) {
+        auto [a, t] = event(i);
+        bus.publish(a, t, InteractionOutcome::TargetEscaped);
+        if ((i + 1) % PER_TICK == 0) bus.flush();
+    }
+    bus.flush();
+    double bus_ns = ms_since(t0) * 1e6 / EVENTS;
+    bus.unsubscribe(token);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << std::setw(10) << "per-NPC" << std::setw(16) << sub_ms
+              << std::setprecision(1) << per_npc_ns << "\n"
+              << std::setprecision(2)
+              << std::setw(10) << "bus" << std::setw(16) << bus_sub_ms
+              << std::setprecision(1) << bus_ns << "\n" << std::defaultfloat;
+
+    static_cast<BinaryFileObserver&>(*obs).flush();
+    std::remove(fname.c_str());
+}
+
+// ======================================================
+// Сохранение и загрузка: текст против снимка
+// ======================================================
+static void bench_snapshot() {
+    constexpr size_t N = 1000000;
+    auto npcs = make_population(N, 10000);
+
+    std::cout << "\n=== save_all / load_all: " << N << " NPCs ===\n";
+    std::cout << std::left << std::setw(8) << "format" << std::setw(12) << "save ms"
+              << std::setw(12) << "load ms" << "MiB\n";
+
+    for (auto [label, format, fname] : {std::tuple{"text", SaveFormat::Text, "bench_world.txt"},
+                                        std::tuple{"binary", SaveFormat::Binary, "bench_world.bin"}}) {
+        auto t0 = Clock::now();
+        save_all(npcs, fname, format);
+        double save_ms = ms_since(t0);
+
+        t0 = Clock::now();
+        auto loaded = load_all(fname);
+        double load_ms = ms_since(t0);
+
+        std::error_code ec;
+        auto bytes = std::filesystem::file_size(fname, ec);
+        std::cout << std::left << std::setw(8) << label << std::fixed << std::setprecision(1)
+                  << std::setw(12) << save_ms << std::setw(12) << load_ms
+                  << bytes / 1048576.0 << (loaded.size() == N ? "" : "  (lost NPCs)") << "\n";
+        std::cout << std::defaultfloat;
+        std::remove(fname);
+    }
+}
+
+// ======================================================
+// Контрольные точки: база и дельты
+// ======================================================
+static void bench_checkpoint() {
+    constexpr size_t N = 1000000;
+    auto npcs = make_population(N, 10000);
+    Checkpointer cp("bench_ckpt.bin");
+
+    std::cout << "\n=== Checkpoints: " << N << " NPCs ===\n";
+    auto t0 = Clock::now();
+    cp.write_base();
+    std::cout << std::fixed << std::setprecision(2)
+              << "base             " << ms_since(t0) << " ms\n";
+
+    for (size_t churn : {size_t(100), size_t(10000), size_t(100000)}) {
+        for (size_t i = 0; i < churn; ++i)
+            npcs[(i * 7919) % N]->move(1, 1, 10001, 10001);
+
+        t0 = Clock::now();
+        size_t written = cp.write_delta();
+        std::cout << "delta " << std::left << std::setw(10) << churn << ' '
+                  << ms_since(t0) << " ms (" << written << " slots)\n";
+    }
+    std::cout << std::defaultfloat;
+    std::remove("bench_ckpt.bin");
+    std::remove("bench_ckpt.bin.delta");
+}
+
+// ======================================================
+// Движок: тики без ограничения частоты
+// ======================================================
+static void bench_engine() {
+    constexpr size_t N = 10000;
+    constexpr uint64_t TICKS = 200;
+    constexpr int SIDE = 1000;
+
+    auto npcs = make_population(N, SIDE);
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    cfg.max_x = SIDE;
+    cfg.max_y = SIDE;
+    Engine engine(cfg);
+    for (auto& npc : npcs) engine.add(npc);
+
+    engine.run_ticks(TICKS);
+    auto st = engine.stats();
+
+    std::cout << "\n=== Engine: " << N << " NPCs, " << TICKS << " ticks unthrottled ===\n";
+    std::cout << std::fixed << std::setprecision(1) << "ticks/s    " << st.ticks_per_s << "\n"
+              << std::setprecision(3);
+    for (size_t p = 0; p < PHASE_COUNT; ++p)
+        std::cout << std::left << std::setw(11) << phase_name(static_cast<Phase>(p))
+                  << st.phase_ms[p] / st.ticks << " ms/tick\n";
+    std::cout << std::defaultfloat;
+}
+
+// ======================================================
+// Состояние NPC под нагрузкой: читатели против одного писателя
+// ======================================================
+// прежняя схема: x, y, alive столбцами под 256 полосами мьютексов
+struct StripedState {
+    static constexpr size_t STRIPES = 256;
+    std::vector<int> x, y;
+    std::vector<char> alive;
+    mutable std::array<std::mutex, STRIPES> locks;
+
+    explicit StripedState(size_t n) : x(n), y(n), alive(n, 1) {}
+
+    NPCState read(uint32_t i) const {
+        std::lock_guard<std::mutex> lck(locks[i % STRIPES]);
+        return {x[i], y[i], alive[i] != 0};
+    }
+    void move(uint32_t i, int dx, int dy) {
+        std::lock_guard<std::mutex> lck(locks[i % STRIPES]);
+        if (x[i] + dx >= 0 && x[i] + dx <= MAP_X) x[i] += dx;
+        if (y[i] + dy >= 0 && y[i] + dy <= MAP_Y) y[i] += dy;
+    }
+};
+
+struct WorldState {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    std::vector<uint32_t> slots;
+
+    explicit WorldState(size_t n) : npcs(make_population(n, MAP_X)) {
+        for (auto &p : npcs) slots.push_back(p->handle.index);
+    }
+    NPCState read(uint32_t i) const { return NPCWorld::instance().state(slots[i]); }
+    void move(uint32_t i, int dx, int dy) { NPCWorld::instance().move(slots[i], dx, dy, MAP_X, MAP_Y); }
+};
+
+template <typename Store>
+static void contention_run(const char *label, Store &store, size_t n, size_t readers) {
+    constexpr auto DURATION = std::chrono::milliseconds(300);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> sink{0};      // чтобы чтения не выбросил оптимизатор
+    uint64_t writes = 0;
+
+    std::vector<std::thread> threads;
+    for (size_t r = 0; r < readers; ++r)
+        threads.emplace_back([&, r] {
+            uint64_t local = 0, sum = 0;
+            uint32_t i = static_cast<uint32_t>(r * 7919 % n);
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int k = 0; k < 256; ++k) {
+                    NPCState st = store.read(i);
+                    sum += st.alive ? st.x + st.y : 0;
+                    if (++i == n) i = 0;
+                }
+                local += 256;
+            }
+            reads += local;
+            sink += sum;
+        });
+
+    auto t0 = Clock::now();
+    uint32_t i = 0;
+    while (Clock::now() - t0 < DURATION) {
+        for (int k = 0; k < 256; ++k) {
+            store.move(i, (k & 1) ? 1 : -1, (k & 2) ? 1 : -1);
+            if (++i == n) i = 0;
+        }
+        writes += 256;
+    }
+    stop = true;
+    for (auto &t : threads) t.join();
+    double s = ms_since(t0) / 1000.0;
+
+    std::cout << std::left << std::setw(10) << label << std::setw(10) << readers
+              << std::fixed << std::setprecision(1)
+              << std::setw(16) << reads.load() / s / 1e6
+              << writes / s / 1e6 << "\n" << std::defaultfloat;
+}
+
+static void bench_contention() {
+    constexpr size_t N = 10000;
+    StripedState striped(N);
+    WorldState world(N);
+
+    std::cout << "\n=== NPC state: " << N << " NPCs, 1 writer + readers ===\n";
+    std::cout << std::left << std::setw(10) << "state" << std::setw(10) << "readers"
+              << std::setw(16) << "reads M/s" << "writes M/s\n";
+    for (size_t readers : {1u, 2u, 4u, 8u}) {
+        contention_run("striped", striped, N, readers);
+        contention_run("atomic", world, N, readers);
+    }
+}
+
+// ======================================================
+// Случайные числа: общий mt19937 против потоков Philox
+// ======================================================
+static void bench_rng() {
+    constexpr size_t N = 10'000'000;
+    volatile int sink = 0;
+
+    std::mt19937 mt{42};
+    auto t0 = Clock::now();
+    int acc = 0;
+    for (size_t i = 0; i < N; ++i) {
+        std::uniform_int_distribution<int> d(-5, 5);
+        acc += d(mt);
+    }
+    double mt_ms = ms_since(t0);
+    sink = acc;
+
+    RandomStream s(StreamKind::User, 0);
+    t0 = Clock::now();
+    acc = 0;
+    for (size_t i = 0; i < N; ++i) acc += s.uniform(-5, 5);
+    double stream_ms = ms_since(t0);
+    sink = acc;
+
+    // как в фазе Move: новый поток на каждую пару чисел
+    uint64_t key = seed();
+    t0 = Clock::now();
+    acc = 0;
+    for (size_t i = 0; i < N / 2; ++i) {
+        RandomStream g(key, StreamKind::Move, 1, static_cast<uint32_t>(i));
+        acc += g.uniform(-5, 5) + g.uniform(-5, 5);
+    }
+    double keyed_ms = ms_since(t0);
+    sink = acc;
+    (void)sink;
+
+    std::cout << "\n=== RNG: " << N << " draws in [-5, 5] ===\n" << std::fixed << std::setprecision(2)
+              << "mt19937 + distribution   " << mt_ms * 1e6 / N << " ns/draw\n"
+              << "philox stream            " << stream_ms * 1e6 / N << " ns/draw\n"
+              << "philox per (tick, slot)  " << keyed_ms * 1e6 / N << " ns/draw\n"
+              << std::defaultfloat;
+}
+
+// ======================================================
+// Отрисовка карты: поток по клеткам против одного буфера
+// ======================================================
+// прежний draw_map: строка цвета на клетку и operator<< на каждый кусок
+static void legacy_draw(std::ostream &os, const WorldFrame &frame, int grid) {
+    std::vector<std::pair<std::string, char>> field(size_t(grid) * grid, {"", ' '});
+    for (size_t k = 0; k < frame.size(); ++k) {
+        const NPCState &st = frame.states[k];
+        NPCType t = frame.roster->types[k];
+        int gx = std::clamp(st.x * grid / MAP_X, 0, grid - 1);
+        int gy = std::clamp(st.y * grid / MAP_Y, 0, grid - 1);
+        field[gx + gy * grid] = {type_color(t), st.alive ? type_to_string(t)[0] : '*'};
+    }
+    os << std::string(3 * grid, '=') << "\n";
+    for (int y = 0; y < grid; ++y) {
+        for (int x = 0; x < grid; ++x) {
+            auto [color, ch] = field[x + y * grid];
+            std::string reset = "\033[0m";
+            os << "[" << color << ch << reset << "]";
+        }
+        os << '\n';
+    }
+    os << std::string(3 * grid, '=') << "\n\n";
+    os.flush();
+}
+
+static void bench_render() {
+    constexpr size_t N = 2000;
+    constexpr int FRAMES = 200;
+    auto npcs = make_population(N, MAP_X);
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    for (auto &npc : npcs) engine.add(npc);
+
+    // кадры заранее, чтобы мерить только вывод
+    std::vector<std::shared_ptr<const WorldFrame>> frames;
+    for (int f = 0; f < FRAMES; ++f) {
+        engine.step();
+        auto v = engine.view();
+        frames.push_back(std::make_shared<WorldFrame>(*v));
+    }
+
+    std::ofstream null_stream("/dev/null");
+    int null_fd = ::open("/dev/null", O_WRONLY);
+
+    std::cout << "\n=== draw_map: " << N << " NPCs, " << FRAMES << " frames ===\n";
+    std::cout << std::left << std::setw(8) << "grid" << std::setw(14) << "legacy us"
+              << std::setw(14) << "full us" << std::setw(14) << "diff us"
+              << std::setw(14) << "full bytes" << "diff bytes\n";
+    for (int grid : {20, 100, 200}) {
+        auto t0 = Clock::now();
+        for (auto &f : frames) legacy_draw(null_stream, *f, grid);
+        double legacy_us = ms_since(t0) * 1000 / FRAMES;
+
+        size_t bytes[2] = {0, 0};
+        double us[2] = {0, 0};
+        for (RenderMode mode : {RenderMode::Full, RenderMode::Diff}) {
+            MapRenderer r(grid, grid, MAP_X, MAP_Y, mode);
+            size_t m = mode == RenderMode::Diff;
+            t0 = Clock::now();
+            for (auto &f : frames) {
+                r.clear();
+                for (size_t k = 0; k < f->size(); ++k)
+                    r.put(f->roster->types[k], f->states[k].x, f->states[k].y, f->states[k].alive);
+                const std::string &out = r.compose();
+                bytes[m] += out.size();
+                if (::write(null_fd, out.data(), out.size()) < 0) break;
+            }
+            us[m] = ms_since(t0) * 1000 / FRAMES;
+        }
+        std::cout << std::setw(8) << grid << std::fixed << std::setprecision(1)
+                  << std::setw(14) << legacy_us << std::setw(14) << us[0] << std::setw(14) << us[1]
+                  << std::setw(14) << bytes[0] / FRAMES << bytes[1] / FRAMES << std::defaultfloat << "\n";
+    }
+    ::close(null_fd);
+}
+
+// ======================================================
+// Тепловая карта: O(клеток) против обхода всех NPC
+// ======================================================
+static void bench_heatmap() {
+    constexpr size_t N = 1000000;
+    constexpr int SIDE = 10000;
+    constexpr int GRID_SIDE = 100;
+    constexpr int FRAMES = 20;
+    auto npcs = make_population(N, SIDE);
+    auto &world = NPCWorld::instance();
+    int null_fd = ::open("/dev/null", O_WRONLY);
+
+    // draw_map по миру: каждый кадр обходит всех NPC
+    MapRenderer scan(GRID_SIDE, GRID_SIDE, SIDE, SIDE);
+    auto t0 = Clock::now();
+    for (int f = 0; f < FRAMES; ++f) {
+        scan.clear();
+        world.for_each([&](uint32_t i) {
+            NPCState st = world.state(i);
+            scan.put(world.type(i), st.x, st.y, st.alive);
+        });
+        scan.present(null_fd);
+    }
+    double scan_ms = ms_since(t0) / FRAMES;
+
+    t0 = Clock::now();
+    DensityMap map(GRID_SIDE, GRID_SIDE, SIDE, SIDE);
+    double build_ms = ms_since(t0);
+
+    MapRenderer heat(GRID_SIDE, GRID_SIDE, SIDE, SIDE);
+    t0 = Clock::now();
+    for (int f = 0; f < FRAMES; ++f) {
+        map.render(heat, f % 2 ? HeatMode::Majority : HeatMode::Density);
+        heat.present(null_fd);
+    }
+    double heat_ms = ms_since(t0) / FRAMES;
+
+    // цена счётчиков в горячем пути: move_all с картой и без
+    std::vector<int> dx(world.slots()), dy(world.slots());
+    for (size_t k = 0; k < dx.size(); ++k) {
+        dx[k] = random_coord(-20, 20);
+        dy[k] = random_coord(-20, 20);
+    }
+    t0 = Clock::now();
+    world.move_all(dx, dy, SIDE, SIDE);
+    double tracked_ms = ms_since(t0);
+    world.untrack(&map);
+    t0 = Clock::now();
+    world.move_all(dx, dy, SIDE, SIDE);
+    double plain_ms = ms_since(t0);
+    world.track(&map);
+    ::close(null_fd);
+
+    std::cout << "\n=== Map view: " << N << " NPCs, " << GRID_SIDE << "x" << GRID_SIDE << " cells ===\n"
+              << std::fixed << std::setprecision(2)
+              << "draw by scan       " << scan_ms << " ms/frame\n"
+              << "heatmap            " << heat_ms << " ms/frame\n"
+              << "density build      " << build_ms << " ms once\n"
+              << "move_all plain     " << plain_ms << " ms\n"
+              << "move_all + density " << tracked_ms << " ms\n" << std::defaultfloat;
+}
+
+// ======================================================
+// Масштабирование пула и движка по числу потоков
+// ======================================================
+static void bench_scaling() {
+    constexpr size_t ITEMS = 1 << 22;
+    constexpr size_t N = 20000;
+    constexpr int SIDE = 1400;
+    constexpr uint64_t TICKS = 50;
+
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    auto npcs = make_population(N, SIDE);
+    std::vector<double> data(ITEMS);
+    for (size_t i = 0; i < ITEMS; ++i) data[i] = double(i % 1000);
+
+    std::cout << "\n=== Scaling: hardware threads " << hw << " ===\n";
+    std::cout << std::left << std::setw(10) << "workers" << std::setw(18) << "parallel_for ms"
+              << std::setw(12) << "steals" << "engine ticks/s\n";
+
+    for (size_t w = 1; w <= std::max<size_t>(hw, 4); w *= 2) {
+        WorkerPool pool(w);
+        std::atomic<double> sink{0};
+        auto t0 = Clock::now();
+        pool.parallel_for(ITEMS, 4096, [&](size_t b, size_t e) {
+            double acc = 0;
+            for (size_t i = b; i < e; ++i) acc += std::sqrt(data[i]) * std::sin(data[i]);
+            sink.fetch_add(acc);
+        });
+        double pf_ms = ms_since(t0);
+
+        EngineConfig cfg;
+        cfg.tick_rate = 0;
+        cfg.workers = w;
+        cfg.max_x = SIDE;
+        cfg.max_y = SIDE;
+        Engine engine(cfg);
+        for (auto& npc : npcs) engine.add(npc);
+        engine.run_ticks(TICKS);
+
+        std::cout << std::left << std::setw(10) << (std::to_string(w) + (w > hw ? "*" : ""))
+                  << std::fixed << std::setprecision(2) << std::setw(18) << pf_ms
+                  << std::setw(12) << pool.steals()
+                  << std::setprecision(1) << engine.stats().ticks_per_s << "\n";
+        std::cout << std::defaultfloat;
+    }
+    std::cout << "* more workers than hardware threads\n";
+}
+
+// ======================================================
+// NAMES
+// ======================================================
+static size_t resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * size_t(sysconf(_SC_PAGESIZE));
+}
+
+static void bench_names() {
+    constexpr size_t N = 1000000;
+    std::cout << "\n=== Names: " << N << " NPCs named <type>_<n> ===\n";
+
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.reserve(N);
+    size_t rss0 = resident_bytes();
+    auto heap0 = alloc_stats();
+    auto t0 = Clock::now();
+    std::string name;
+    for (size_t i = 0; i < N; ++i) {
+        NPCType t = static_cast<NPCType>(1 + i % 4);
+        name = type_to_string(t);
+        name += '_';
+        name += std::to_string(i + 1);
+        npcs.push_back(createNPC(t, name, int(i % 1000), int(i / 1000)));
+    }
+    double create_ms = ms_since(t0);
+    auto heap = alloc_stats() - heap0;
+    size_t rss = resident_bytes() - rss0;
+
+    t0 = Clock::now();
+    std::ofstream null("/dev/null");
+    for (auto &p : npcs) p->save(null);
+    double save_ms = ms_since(t0);
+
+    std::cout << "sizeof(Orc)          " << sizeof(Orc) << " B\n"
+              << "resident per NPC     " << std::fixed << std::setprecision(1) << double(rss) / N << " B\n"
+              << "heap calls per NPC   ";
+    if (alloc_stats_enabled())
+        std::cout << std::setprecision(2) << double(heap.allocations) / N << "\n";
+    else
+        std::cout << "n/a (counted only in tests)\n";
+    std::cout << "create               " << std::setprecision(1) << create_ms << " ms\n"
+              << "save (names printed) " << save_ms << " ms\n";
+    std::cout << std::defaultfloat;
+}
+
+// ======================================================
+// MAIN
+// ======================================================
+int main(int argc, char **argv) {
+    const std::vector<std::pair<std::string, std::function<void()>>> benches{
+        {"spatial", bench_spatial},
+        {"interaction", bench_interaction},
+        {"resolver", bench_resolver},
+        {"plumbing", bench_plumbing},
+        {"simd", bench_simd},
+        {"observer", bench_observer},
+        {"bus", bench_bus},
+        {"snapshot", bench_snapshot},
+        {"checkpoint", bench_checkpoint},
+        {"engine", bench_engine},
+        {"rng", bench_rng},
+        {"contention", bench_contention},
+        {"render", bench_render},
+        {"heatmap", bench_heatmap},
+        {"scaling", bench_scaling},
+        {"names", bench_names},
+    };
+
+    std::string only = argc > 1 ? argv[1] : "";
+    for (auto &[name, fn] : benches)
+        if (only.empty() || only == name) fn();
+    return 0;
+}
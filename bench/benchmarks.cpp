@@ -0,0 +1,204 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "../include/npc.h"
+#include "../include/game_utils.h"
+#include "../include/engine.h"
+#include "../include/rng.h"
+
+// Google Benchmark: микробенчмарки отдельных операций и прогон
+// симуляции без вывода. bench/bench.cpp сравнивает варианты реализаций,
+// а здесь - числа для сравнения версий между собой:
+//   benchmarks --benchmark_out=result.json --benchmark_out_format=json
+// или цель benchmarks_json.
+
+static std::vector<std::shared_ptr<NPC>> make_npcs(size_t n, int side) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        npcs.push_back(createNPC(static_cast<NPCType>(1 + i % 4), static_cast<uint32_t>(i + 1),
+                                 rng().uniform(0, side), rng().uniform(0, side)));
+    return npcs;
+}
+
+// ======================================================
+// NPC
+// ======================================================
+static void BM_IsClose(benchmark::State &state) {
+    auto npcs = make_npcs(1024, MAP_X);
+    size_t i = 0;
+    for (auto _ : state) {
+        const NPC &a = *npcs[i & 1023];
+        const NPC &b = *npcs[(i * 7 + 1) & 1023];
+        benchmark::DoNotOptimize(a.is_close(b, 10));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IsClose);
+
+static void BM_Move(benchmark::State &state) {
+    auto npcs = make_npcs(1024, MAP_X);
+    size_t i = 0;
+    for (auto _ : state) {
+        npcs[i & 1023]->move(int(i % 11) - 5, int(i % 7) - 3, MAP_X, MAP_Y);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Move);
+
+// NPC создаётся и сразу освобождается: блок возвращается в пул
+static void BM_CreateNPC(benchmark::State &state) {
+    bool numbered = state.range(0);
+    std::string name = "Old Oak";
+    uint32_t n = 0;
+    for (auto _ : state) {
+        auto npc = numbered ? createNPC(NPCType::Druid, ++n, 10, 10)
+                            : createNPC(NPCType::Druid, name, 10, 10);
+        benchmark::DoNotOptimize(npc.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateNPC)->ArgName("numbered")->Arg(0)->Arg(1);
+
+// ======================================================
+// Взаимодействие
+// ======================================================
+static void BM_VisitorDispatch(benchmark::State &state) {
+    auto actors = make_npcs(4, 100);
+    auto targets = make_npcs(64, 100);
+    size_t i = 0;
+    for (auto _ : state) {
+        const NPC &actor = *actors[i & 3];
+        NPC &target = *targets[i & 63];
+        AttackVisitor attack(actor);
+        SupportVisitor support(actor);
+        benchmark::DoNotOptimize(target.accept(attack));
+        benchmark::DoNotOptimize(target.accept(support));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_VisitorDispatch);
+
+// Пары далеко друг от друга: resolve отсекает их по дистанции, и
+// меряется путь события через очередь, а не бой
+static void BM_QueuePushDrain(benchmark::State &state) {
+    size_t batch = static_cast<size_t>(state.range(0));
+    auto &im = InteractionManager::instance();
+    im.configure(1 << 16, OverflowPolicy::DropOldest);
+
+    std::vector<std::shared_ptr<NPC>> npcs;
+    std::vector<InteractionEvent> events;
+    for (size_t i = 0; i < batch; ++i) {
+        npcs.push_back(createNPC(NPCType::Orc, static_cast<uint32_t>(i + 1), 0, 0));
+        npcs.push_back(createNPC(NPCType::Bear, static_cast<uint32_t>(i + 1), MAP_X, MAP_Y));
+        events.push_back({npcs[2 * i]->handle, npcs[2 * i + 1]->handle});
+    }
+
+    for (auto _ : state) {
+        for (auto &ev : events) im.push(ev);
+        benchmark::DoNotOptimize(im.drain(batch));
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    im.configure(InteractionManager::DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+}
+BENCHMARK(BM_QueuePushDrain)->Arg(16)->Arg(256);
+
+// ======================================================
+// Сохранение и вывод
+// ======================================================
+static std::string temp_path(const char *name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static void BM_SaveAll(benchmark::State &state) {
+    auto format = static_cast<SaveFormat>(state.range(0));
+    auto npcs = make_npcs(static_cast<size_t>(state.range(1)), MAP_X);
+    std::string fname = temp_path("benchmarks_save.dat");
+    for (auto _ : state)
+        save_all(npcs, fname, format);
+    state.SetItemsProcessed(state.iterations() * npcs.size());
+    std::remove(fname.c_str());
+}
+BENCHMARK(BM_SaveAll)->ArgNames({"binary", "npcs"})->Args({0, 10000})->Args({1, 10000})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_LoadAll(benchmark::State &state) {
+    auto format = static_cast<SaveFormat>(state.range(0));
+    size_t n = static_cast<size_t>(state.range(1));
+    std::string fname = temp_path("benchmarks_load.dat");
+    save_all(make_npcs(n, MAP_X), fname, format);
+    for (auto _ : state) {
+        auto loaded = load_all(fname);
+        benchmark::DoNotOptimize(loaded.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    std::remove(fname.c_str());
+}
+BENCHMARK(BM_LoadAll)->ArgNames({"binary", "npcs"})->Args({0, 10000})->Args({1, 10000})
+    ->Unit(benchmark::kMicrosecond);
+
+// Кадр выводится в stdout; на время замера stdout уходит в /dev/null
+static void BM_DrawMap(benchmark::State &state) {
+    int grid = static_cast<int>(state.range(0));
+    auto npcs = make_npcs(2000, MAP_X);
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    for (auto &npc : npcs) engine.add(npc);
+    engine.step();
+    auto frame = engine.view();
+    MapRenderer r(grid, grid, MAP_X, MAP_Y, static_cast<RenderMode>(state.range(1)));
+
+    std::fflush(stdout);
+    int saved = ::dup(1);
+    int null_fd = ::open("/dev/null", O_WRONLY);
+    ::dup2(null_fd, 1);
+    for (auto _ : state)
+        draw_map(*frame, r);
+    std::fflush(stdout);
+    ::dup2(saved, 1);
+    ::close(saved);
+    ::close(null_fd);
+}
+BENCHMARK(BM_DrawMap)->ArgNames({"grid", "diff"})->Args({20, 0})->Args({100, 0})->Args({100, 1})
+    ->Unit(benchmark::kMicrosecond);
+
+// ======================================================
+// Симуляция: N NPC, K тиков без ограничения частоты
+// ======================================================
+static void BM_Simulation(benchmark::State &state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    uint64_t ticks = static_cast<uint64_t>(state.range(1));
+    int side = static_cast<int>(std::sqrt(double(n)) * 14);     // ~1 NPC на квадрат 14x14
+
+    auto npcs = make_npcs(n, side);
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    cfg.max_x = side;
+    cfg.max_y = side;
+    Engine engine(cfg);
+    for (auto &npc : npcs) engine.add(npc);
+
+    for (auto _ : state)
+        engine.run_ticks(ticks);
+
+    auto st = engine.stats();
+    state.counters["ticks/s"] = benchmark::Counter(double(st.ticks), benchmark::Counter::kIsRate);
+    state.counters["pairs/tick"] = st.ticks ? double(st.pairs) / st.ticks : 0;
+    state.SetItemsProcessed(state.iterations() * ticks * n);
+}
+BENCHMARK(BM_Simulation)->ArgNames({"npcs", "ticks"})->Args({1000, 100})->Args({10000, 50})
+    ->Args({100000, 10})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// ---------------- Счётчики выделений памяти ----------------
+// В сборке с ALLOC_STATS (опция CMake, включена по умолчанию и действует
+// только на цель tests) глобальные operator new и delete считают вызовы
+// и байты. Так проверяется, что тик
+// в установившемся режиме не ходит в кучу: снять alloc_stats() до и после
+// и вычесть. Счётчики общие и relaxed; без опции они всегда нулевые.
+struct AllocStats {
+    uint64_t allocations{0};
+    uint64_t deallocations{0};
+    uint64_t bytes{0};          // запрошено всего
+
+    AllocStats operator-(const AllocStats &o) const {
+        return {allocations - o.allocations, deallocations - o.deallocations, bytes - o.bytes};
+    }
+};
+
+bool alloc_stats_enabled();
+AllocStats alloc_stats();
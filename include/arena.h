@@ -0,0 +1,45 @@
+#pragma once
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <cstddef>
+
+// ---------------- Арена ----------------
+// Выделение сдвигом указателя внутри блоков, освобождение - только
+// всё сразу через reset(). Блоки после reset остаются и переиспользуются,
+// поэтому арена, которую сбрасывают каждый тик, после прогрева в кучу
+// не ходит. Деструкторы не вызываются: только тривиальные типы.
+class Arena {
+public:
+    explicit Arena(size_t block_bytes = 64 << 10);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // align не больше __STDCPP_DEFAULT_NEW_ALIGNMENT__: так выровнены блоки
+    void* allocate(size_t bytes, size_t align);
+
+    template <typename T>
+    T* allocate_array(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "арена не вызывает деструкторы");
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void reset();
+
+    size_t used() const;        // байт с последнего reset
+    size_t capacity() const;    // байт во всех блоках
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> mem;
+        size_t size;
+    };
+
+    size_t block_bytes;
+    std::vector<Block> blocks;
+    size_t current{0};          // блок, из которого сейчас режем
+    size_t offset{0};           // занято в текущем блоке
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// ---------------- Асинхронный журнал ----------------
+// Каждый пишущий поток копирует запись в свой кольцевой буфер без
+// блокировок, фоновый поток периодически собирает буферы и пишет их
+// в файл одним вызовом write. Запись никогда не разрывается между сбросами:
+// она копируется в буфер целиком или не пишется вовсе.
+enum class FsyncPolicy {
+    Never,
+    EveryFlush,
+    OnClose
+};
+
+struct AsyncLogOptions {
+    std::chrono::milliseconds flush_interval{50};
+    size_t flush_bytes{1 << 16};     // будить писателя раньше срока
+    size_t staging_bytes{1 << 18};   // буфер на поток
+    FsyncPolicy fsync{FsyncPolicy::OnClose};
+};
+
+class AsyncLog {
+public:
+    explicit AsyncLog(const std::string &filename, AsyncLogOptions opts = {}, bool truncate = true);
+    ~AsyncLog();
+
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+
+    bool good() const { return fd.load(std::memory_order_acquire) >= 0; }
+
+    // false, если запись отброшена: журнал закрывается или запись
+    // длиннее буфера потока (staging_bytes)
+    bool write(std::string_view record);
+    // дождаться, пока всё переданное до вызова окажется в файле
+    void flush();
+    void close();
+
+    size_t bytes_written() const { return written.load(std::memory_order_relaxed); }
+
+private:
+    struct Staging {
+        explicit Staging(size_t cap_) : buf(new char[cap_]), cap(cap_) {}
+
+        std::unique_ptr<char[]> buf;
+        size_t cap;
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+    };
+
+    Staging& local();
+    bool append(std::string_view record);
+    void wake();
+    void flusher_loop();
+    void drain_to_file();
+
+    const uint64_t log_id;
+    AsyncLogOptions opts;
+    std::atomic<int> fd{-1};
+
+    std::mutex staging_mtx;
+    std::vector<std::unique_ptr<Staging>> stagings;
+
+    std::mutex mtx;
+    std::condition_variable wake_cv;
+    std::condition_variable flushed_cv;
+    std::atomic<bool> wake_pending{false};
+    uint64_t flush_requested{0};
+    uint64_t flush_done{0};
+    std::atomic<bool> closing{false};
+    bool closed{false};
+    // write() между проверкой closing и концом копирования; close()
+    // ждёт, пока их не останется, и только потом сбрасывает последнее
+    std::atomic<int> writers{0};
+
+    std::vector<char> out;
+    std::atomic<size_t> written{0};
+    std::thread flusher;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+
+// ---------------- Контрольные точки ----------------
+// path - полный снимок мира (snapshot.h), path + ".delta" - кадры с NPC,
+// которые изменились после предыдущей точки. Изменения берутся из
+// отметок NPCWorld::drain_dirty, поэтому дельта стоит столько, сколько
+// NPC сдвинулось, умерло, появилось или пропало, а не размер мира.
+namespace checkpoint {
+
+constexpr char MAGIC[8] = {'N', 'P', 'C', 'D', 'E', 'L', 'T', 'A'};
+
+enum class DeltaKind : uint8_t {
+    Update = 1,     // x, y, alive
+    Spawn = 2,      // новый NPC в слоте, за записью идёт имя
+    Remove = 3
+};
+
+struct FileHeader {
+    char magic[8];
+    uint64_t tag;           // совпадает с tag снимка
+};
+
+struct FrameHeader {
+    uint32_t seq;
+    uint32_t count;
+    uint32_t bytes;         // длина записей кадра вместе с именами
+    uint32_t fnv;
+};
+
+struct DeltaRecord {
+    uint32_t slot;
+    DeltaKind kind;
+    uint8_t type;
+    uint8_t alive;
+    uint8_t name_len;
+    int32_t x;
+    int32_t y;
+};
+
+static_assert(sizeof(FileHeader) == 16);
+static_assert(sizeof(FrameHeader) == 16);
+static_assert(sizeof(DeltaRecord) == 16);
+
+} // namespace checkpoint
+
+// Пишет точки для всего NPCWorld. Отметки изменений в мире общие,
+// поэтому Checkpointer должен быть один. spawn/release во время записи
+// не допускаются.
+class Checkpointer {
+public:
+    explicit Checkpointer(std::string path);
+
+    // полный снимок; файл дельт начинается заново
+    bool write_base();
+    // кадр с изменившимися слотами, возвращает их число
+    size_t write_delta();
+
+    const std::string& path() const { return base_path; }
+
+private:
+    std::string base_path;
+    std::string delta_path;
+    std::ofstream delta;
+    uint64_t tag{0};
+    uint32_t seq{0};
+    std::vector<uint32_t> known;    // поколение+1 NPC слота на момент последней точки
+    std::vector<char> frame;
+};
+
+// снимок плюс все целые кадры дельт с тем же tag
+std::vector<std::shared_ptr<NPC>> load_checkpoint(const std::string &path);
@@ -0,0 +1,10 @@
+#pragma once
+#include "npc.h"
+
+// Тип из файла настроек TypeRegistry, без своего класса. Правила и
+// параметры берутся из реестра по номеру типа.
+struct Creature : public NPC {
+    Creature() = default;
+    Creature(NPCType t, const std::string &nm, int x_, int y_);
+    InteractionOutcome accept(IInteractionVisitor &visitor) override;
+};
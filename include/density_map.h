@@ -0,0 +1,76 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+#include "map_renderer.h"
+#include "type_registry.h"
+
+// ---------------- Карта плотности ----------------
+// Счётчики NPC по клеткам, типам и alive. NPCWorld обновляет их сам
+// при каждом spawn, release, сдвиге, смерти и лечении, поэтому кадр
+// тепловой карты стоит O(клеток), а не O(NPC), и не зависит от того,
+// кто обошёлся последним. Карта считает мир при создании; создавать
+// её нужно, пока NPC никто не двигает. Число типов берётся из
+// TypeRegistry при создании; типы, добавленные позже, считаются
+// в счётчиках NPCType::Unknown.
+enum class HeatMode {
+    Density,    // символ по числу NPC в клетке, цвет - тип большинства живых
+    Majority    // символ и цвет типа большинства живых, '*' если живых нет
+};
+
+class DensityMap {
+public:
+    DensityMap(int cols, int rows, int world_x, int world_y);
+    ~DensityMap();
+
+    DensityMap(const DensityMap&) = delete;
+    DensityMap& operator=(const DensityMap&) = delete;
+
+    int cols() const { return w; }
+    int rows() const { return h; }
+    // счётчиков на клетку - types() * 2, индекс типа - NPCType
+    size_t types() const { return kinds; }
+    size_t cells() const { return size_t(w) * h; }
+    // x * cols / world_x без деления, с прижатием к краю
+    size_t cell_of(int x, int y) const {
+        int64_t gx = std::clamp<int64_t>((int64_t(x) * scale_x) >> 32, 0, w - 1);
+        int64_t gy = std::clamp<int64_t>((int64_t(y) * scale_y) >> 32, 0, h - 1);
+        return size_t(gx) + size_t(gy) * w;
+    }
+
+    uint32_t count(size_t cell, NPCType t, bool alive) const {
+        return counts[slot(cell, t, alive)].load(std::memory_order_relaxed);
+    }
+    uint32_t total(size_t cell) const;
+    uint32_t alive(size_t cell) const;
+
+    // из NPCWorld; аргументы - упакованные NPCState
+    void add(NPCType t, uint64_t state);
+    void remove(NPCType t, uint64_t state);
+    // на каждый сдвиг, поэтому в заголовке; внутри клетки ничего не пишет
+    void change(NPCType t, uint64_t was, uint64_t now) {
+        NPCState a = NPCState::unpack(was), b = NPCState::unpack(now);
+        size_t from = slot(cell_of(a.x, a.y), t, a.alive);
+        size_t to = slot(cell_of(b.x, b.y), t, b.alive);
+        if (from == to) return;
+        counts[from].fetch_sub(1, std::memory_order_relaxed);
+        counts[to].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // заполнить рендерер того же размера
+    void render(MapRenderer &r, HeatMode mode) const;
+
+private:
+    size_t slot(size_t cell, NPCType t, bool alive) const {
+        size_t k = size_t(t) < kinds ? size_t(t) : 0;
+        return cell * kinds * 2 + k * 2 + (alive ? 1 : 0);
+    }
+
+    int w, h;
+    size_t kinds;
+    int64_t scale_x, scale_y;           // cols / world_x в формате 32.32
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+#include "spatial_grid.h"
+#include "game_utils.h"
+#include "worker_pool.h"
+#include "world_frame.h"
+
+// ---------------- Движок симуляции ----------------
+// Один поток крутит тики с фиксированным шагом. Тик - это фазы
+// Move (сдвиг всех живых NPC), Detect (пары в радиусе по сетке),
+// Resolve (бой и лечение через InteractionManager::resolve_batch)
+// и Observe (публикация кадра мира, пачка исходов тика подписчикам
+// EventBus, затем подписчики on_tick). Очередь InteractionManager и его
+// поток обработки движку не нужны. При workers > 1 фазы Move, Detect
+// и Resolve делятся между потоками WorkerPool. Случайности берутся из
+// потоков rng.h, привязанных к тику и слоту или номеру пары.
+enum class Phase {
+    Move,
+    Detect,
+    Resolve,
+    Observe
+};
+
+constexpr size_t PHASE_COUNT = 4;
+const char* phase_name(Phase p);
+
+// что делать, если тики не успевают за часами
+enum class CatchUp {
+    Burst,      // догнать подряд, но не больше max_catch_up тиков
+    Skip        // выбросить отставание и продолжить с текущего момента
+};
+
+struct EngineConfig {
+    double tick_rate{100.0};    // тиков в секунду; 0 - без ограничения
+    CatchUp catch_up{CatchUp::Burst};
+    size_t max_catch_up{5};
+    size_t workers{1};          // вместе с потоком движка
+    // Resolve по порядку пар даже при workers > 1: при одном сиде
+    // выживают одни и те же NPC при любом числе потоков
+    bool deterministic{true};
+    int max_x{MAP_X};
+    int max_y{MAP_Y};
+};
+
+struct EngineStats {
+    uint64_t ticks{0};
+    uint64_t skipped{0};        // тики, выброшенные политикой отставания
+    uint64_t run_ticks{0};      // тики, сделанные внутри run, без ручных step()
+    double elapsed_s{0};        // время внутри run
+    double ticks_per_s{0};      // run_ticks / elapsed_s
+    std::array<double, PHASE_COUNT> phase_ms{};     // сумма за все тики
+    uint64_t pairs{0};          // пар, найденных в фазе Detect
+};
+
+class Engine {
+public:
+    explicit Engine(EngineConfig cfg = {});
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    void add(const std::shared_ptr<NPC> &npc);
+    // f(tick) в фазе Observe каждые every тиков
+    void on_tick(std::function<void(uint64_t)> f, uint64_t every = 1);
+
+    // один тик сразу, без ожидания
+    void step();
+    void run_ticks(uint64_t n);
+    void run_for(std::chrono::nanoseconds duration);
+    // можно звать из другого потока или из on_tick; стоп до run
+    // не теряется: ближайший run сразу вернётся и сбросит его
+    void stop() { stopping = true; }
+    // nullptr при workers <= 1; доступен хукам, например для draw_map
+    WorkerPool* workers() const { return pool.get(); }
+    // кадр на конец последнего тика, можно читать из любого потока
+    std::shared_ptr<const WorldFrame> view() const { return frames.latest(); }
+
+    EngineStats stats() const { return st; }
+    const EngineConfig& config() const { return cfg; }
+    uint64_t tick() const { return st.ticks; }
+
+private:
+    struct Hook {
+        std::function<void(uint64_t)> f;
+        uint64_t every;
+    };
+
+    void run(uint64_t max_ticks, std::chrono::steady_clock::time_point deadline);
+    void move_phase();
+    void detect_phase();
+    void resolve_phase();
+    void observe_phase();
+
+    EngineConfig cfg;
+    SpatialGrid grid;
+    std::unique_ptr<WorkerPool> pool;
+    std::vector<Hook> hooks;
+    FramePublisher frames;
+    std::vector<int> shift_x;
+    std::vector<int> shift_y;
+    std::vector<InteractionEvent> events;
+    std::vector<std::vector<InteractionEvent>> row_events;
+    std::atomic<bool> stopping{false};
+    EngineStats st;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+#include "arena.h"
+
+// ---------------- Шина событий ----------------
+// Наблюдатель подписывается один раз на всю игру, а не на каждого NPC.
+// InteractionManager::apply_outcome кладёт исход в буфер своего потока,
+// как AsyncLog, без общей блокировки; flush в конце тика собирает буферы
+// в одну пачку и отдаёт каждому подписчику span за один вызов on_batch.
+// Span живёт до возврата из on_batch: пачка лежит в арене шины.
+// Внутри буфера порядок событий сохраняется, между потоками - нет.
+struct EventFilter {
+    uint32_t actors{~0u};       // бит на номер типа
+    uint32_t targets{~0u};
+    uint32_t outcomes{~0u};     // бит на InteractionOutcome
+
+    static constexpr uint32_t bit(NPCType t) { return 1u << (static_cast<uint32_t>(t) & 31); }
+    static constexpr uint32_t bit(InteractionOutcome o) { return 1u << static_cast<uint32_t>(o); }
+
+    bool all() const { return actors == ~0u && targets == ~0u && outcomes == ~0u; }
+    bool accepts(const InteractionRecord &e) const {
+        return (actors & bit(e.actor_type)) && (targets & bit(e.target_type)) &&
+               (outcomes & bit(e.outcome));
+    }
+};
+
+class EventBus {
+public:
+    using Token = uint64_t;
+
+    static EventBus& instance();
+
+    Token subscribe(const std::shared_ptr<IInteractionObserver> &obs, EventFilter filter = {});
+    void unsubscribe(Token token);
+    size_t subscribers() const { return active.load(std::memory_order_relaxed); }
+
+    // без подписчиков ничего не копирует
+    void publish(const NPC &actor, const NPC &target, InteractionOutcome outcome);
+    // доставить накопленное; число событий в пачке
+    size_t flush();
+
+private:
+    EventBus() = default;
+
+    struct Buffer {
+        std::mutex mtx;
+        std::vector<InteractionRecord> events;
+        std::vector<InteractionRecord> spare;   // трогает только flush
+    };
+    struct Subscriber {
+        Token token;
+        std::shared_ptr<IInteractionObserver> obs;
+        EventFilter filter;
+    };
+
+    Buffer& local();
+
+    std::atomic<size_t> active{0};
+
+    std::mutex subs_mtx;
+    std::vector<Subscriber> subs;
+    Token next_token{1};
+
+    std::mutex buffers_mtx;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+
+    // держится всё время flush: пачки доставляются по одной
+    std::mutex flush_mtx;
+    std::vector<std::shared_ptr<Buffer>> taken;
+    std::vector<Subscriber> targets;
+    Arena payload;              // пачка и её отфильтрованные копии
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+
+// ---------------- Двоичный журнал взаимодействий ----------------
+// Файл: заголовок и поток записей по RECORD_SIZE байт. Имя NPC пишется
+// отдельной записью в каждом блоке перед первым событием с этим слотом,
+// события ссылаются на слот: испорченный блок не уносит имена из
+// следующих. После каждых CHECKSUM_EVERY записей идёт запись с FNV-1a
+// предыдущего блока; группа имён с событием не разрывается между
+// блоками, поэтому блок может закрыться раньше. Порядок байт - родной для машины (little-endian).
+namespace event_log {
+
+constexpr char MAGIC[8] = {'N', 'P', 'C', 'E', 'V', 'L', 'O', 'G'};
+constexpr uint16_t VERSION = 1;
+constexpr size_t RECORD_SIZE = 24;
+constexpr uint32_t CHECKSUM_EVERY = 256;
+constexpr size_t NAME_CHUNK = 16;
+constexpr size_t MAX_NAME = 255;
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+
+enum class RecordKind : uint8_t {
+    Event = 1,
+    Name = 2,
+    Checksum = 3
+};
+
+struct Header {
+    char magic[8];
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t checksum_every;
+    uint64_t start_unix_us;
+    uint64_t reserved;
+};
+
+struct EventRecord {
+    RecordKind kind;
+    uint8_t outcome;
+    uint8_t actor_type;
+    uint8_t target_type;
+    uint32_t actor;         // слот в NPCWorld
+    uint32_t target;
+    int16_t ax, ay, tx, ty;
+    uint32_t time_us;       // от начала журнала, по модулю 2^32
+};
+
+struct NameRecord {
+    RecordKind kind;
+    uint8_t length;         // полная длина имени
+    uint8_t part;           // номер куска по NAME_CHUNK байт
+    uint8_t reserved;
+    uint32_t id;
+    char text[NAME_CHUNK];
+};
+
+struct ChecksumRecord {
+    RecordKind kind;
+    uint8_t reserved[3];
+    uint32_t count;         // записей в блоке
+    uint32_t fnv;
+    uint32_t reserved2;
+    uint64_t total;         // записей с начала файла, не считая контрольных
+};
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(EventRecord) == RECORD_SIZE);
+static_assert(sizeof(NameRecord) == RECORD_SIZE);
+static_assert(sizeof(ChecksumRecord) == RECORD_SIZE);
+
+uint32_t fnv1a(uint32_t h, const void *data, size_t n);
+
+} // namespace event_log
+
+// Пишет журнал большими блоками: записи копируются в буфер под коротким
+// замком, полный буфер меняется местами с запасным и уходит в файл, пока
+// следующие события пишутся в новый.
+class EventLogWriter {
+public:
+    explicit EventLogWriter(const std::string &filename, size_t buffer_bytes = 1 << 20);
+    ~EventLogWriter();
+
+    EventLogWriter(const EventLogWriter&) = delete;
+    EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+    bool good() const { return fd >= 0; }
+
+    void write(const NPC &actor, const NPC &target, InteractionOutcome outcome);
+    // пачка под одним замком и с одной отметкой времени; события с
+    // освобождёнными NPC пропускаются
+    void write(std::span<const InteractionRecord> events);
+    // отдать буфер в файл; незакрытый блок проверится после следующей контрольной записи
+    void flush();
+    // дописать контрольную запись последнего блока и закрыть файл
+    void close();
+
+    size_t records() const;
+    size_t bytes_written() const;
+
+private:
+    void append_event(const NPC &actor, const NPC &target, event_log::EventRecord &ev,
+                      std::unique_lock<std::mutex> &lck);
+    void append(const void *rec);
+    void append_name(uint32_t id, std::string_view name);
+    void append_checksum();
+    void spill(std::unique_lock<std::mutex> &lck);
+    void write_out(const char *data, size_t n);
+
+    int fd{-1};
+    std::chrono::steady_clock::time_point start;
+
+    mutable std::mutex mtx;
+    std::vector<char> buf;
+    size_t used{0};
+    struct Named {
+        uint32_t generation;        // поколение+1, 0 - имени не было
+        uint32_t block;
+    };
+    std::vector<Named> named;       // последнее записанное имя по слоту
+    std::string name_scratch[2];    // номерные имена, под замком
+    uint32_t block_fnv{event_log::FNV_OFFSET};
+    uint32_t in_block{0};
+    uint32_t block_no{0};
+    uint64_t total{0};
+    std::atomic<size_t> written{0};
+
+    // держится от обмена буферов до конца write: порядок блоков в файле
+    // совпадает с порядком обмена
+    std::mutex write_mtx;
+    std::vector<char> spare;
+};
+
+struct DecodedEvent {
+    std::string actor;
+    std::string target;
+    NPCType actor_type;
+    NPCType target_type;
+    int ax, ay, tx, ty;
+    InteractionOutcome outcome;
+    uint64_t time_us;
+};
+
+struct EventLogContents {
+    bool ok{false};
+    std::string error;
+    std::vector<DecodedEvent> events;
+    size_t blocks{0};        // проверенных блоков
+    size_t bad_blocks{0};    // блоков с неверной суммой, их события пропущены
+    size_t unverified{0};    // событий после последней контрольной записи
+};
+
+EventLogContents read_event_log(const std::string &filename);
@@ -4,11 +4,24 @@
 #include <memory>
 #include <string>
 #include <atomic>
-#include <random>
+#include <mutex>
+#include <condition_variable>
+#include <array>
 #include "npc.h"
 #include "orc.h"
 #include "squirrel.h"
 #include "bear.h"
+#include "druid.h"
+#include "mpsc_queue.h"
+#include "worker_pool.h"
+#include "async_log.h"
+#include "event_log.h"
+#include "snapshot.h"
+#include "rng.h"
+#include "type_registry.h"
+#include "event_bus.h"
+#include "map_renderer.h"
+#include "density_map.h"
 
 constexpr int MAP_X = 100;
 constexpr int MAP_Y = 100;
@@ -21,78 +34,209 @@ private:
 
 public:
     static std::shared_ptr<IInteractionObserver> get();
-    void on_interaction(const std::shared_ptr<NPC> &actor,
-                  const std::shared_ptr<NPC> &target,
+    void on_interaction(const NPC &actor, const NPC &target,
                   InteractionOutcome outcome) override;
 };
 
+// строка текстовой таблицы журнала
+struct LogRow {
+    std::string_view actor;
+    NPCType actor_type;
+    int ax, ay;
+    std::string_view target;
+    NPCType target_type;
+    int tx, ty;
+    InteractionOutcome outcome;
+};
+
 class FileObserver : public IInteractionObserver {
 private:
-    explicit FileObserver(const std::string& filename);
+    explicit FileObserver(const std::string& filename, AsyncLogOptions opts);
     std::string fname;
+    AsyncLog log;
+    std::string batch_buf;
+    std::string actor_name, target_name;    // под номерные имена в on_batch
     static const int W1, W2, WP, WA, W3, W4, WP2;
 
+public:
+    // параметры журнала учитываются только при первом вызове
+    static std::shared_ptr<IInteractionObserver> get(const std::string& filename,
+                                                     AsyncLogOptions opts = {});
+    void on_interaction(const NPC &actor, const NPC &target,
+                  InteractionOutcome outcome) override;
+    // строки пачки уходят в журнал кусками по несколько килобайт
+    void on_batch(std::span<const InteractionRecord> events) override;
+    void flush();
+
+    // заголовок таблицы с разделителем
+    static std::string table_header();
+    // как snprintf: длина строки без '\0', 0 для NoInteraction
+    static int format_row(char *buf, size_t size, const LogRow &row);
+};
+
+// Тот же журнал в двоичном виде, см. event_log.h; читается log_decode
+class BinaryFileObserver : public IInteractionObserver {
+private:
+    explicit BinaryFileObserver(const std::string& filename);
+    EventLogWriter log;
+
 public:
     static std::shared_ptr<IInteractionObserver> get(const std::string& filename);
-    void on_interaction(const std::shared_ptr<NPC> &actor,
-                  const std::shared_ptr<NPC> &target,
+    void on_interaction(const NPC &actor, const NPC &target,
                   InteractionOutcome outcome) override;
+    void on_batch(std::span<const InteractionRecord> events) override;
+    void flush();
 };
 
 // ---------------- Логика боя ----------------
+// Посетители держат ссылку на действующего NPC только на время accept.
+// Правила берутся из TypeRegistry; InteractionManager обходится без них.
 struct AttackVisitor : public IInteractionVisitor {
-    explicit AttackVisitor(const std::shared_ptr<NPC> &actor_);
-    InteractionOutcome visit([[maybe_unused]] Orc& target) override;
-    InteractionOutcome visit([[maybe_unused]] Bear& target) override;
-    InteractionOutcome visit([[maybe_unused]] Squirrel& target) override;
-    InteractionOutcome visit([[maybe_unused]] Druid& target) override;
+    explicit AttackVisitor(const NPC &actor_);
+    InteractionOutcome visit(Orc& target) override;
+    InteractionOutcome visit(Bear& target) override;
+    InteractionOutcome visit(Squirrel& target) override;
+    InteractionOutcome visit(Druid& target) override;
+    InteractionOutcome visit(NPC& target) override;
 private:
-    std::shared_ptr<NPC> actor;
-    bool dice();
+    InteractionOutcome attack(const NPC &target) const;
+    const NPC &actor;
 };
 
 struct SupportVisitor : public IInteractionVisitor {
-    explicit SupportVisitor(const std::shared_ptr<NPC>& actor_);
+    explicit SupportVisitor(const NPC &actor_);
 
-    InteractionOutcome visit(Orc&) override;
-    InteractionOutcome visit(Bear&) override;
-    InteractionOutcome visit(Squirrel&) override;
-    InteractionOutcome visit(Druid&) override;
+    InteractionOutcome visit(Orc& target) override;
+    InteractionOutcome visit(Bear& target) override;
+    InteractionOutcome visit(Squirrel& target) override;
+    InteractionOutcome visit(Druid& target) override;
+    InteractionOutcome visit(NPC& target) override;
 
 private:
-    std::shared_ptr<NPC> actor;
+    InteractionOutcome support(const NPC &target) const;
+    const NPC &actor;
 };
 
+// Пара NPC по дескрипторам NPCWorld: 16 байт без счётчиков ссылок.
+// Дескриптор не держит NPC; если NPC освобождён до разбора события,
+// поколение слота уже другое и событие пропускается. Сам разбор идёт
+// под NPCWorld::guard обоих слотов, так что найденные NPC не
+// уничтожаются до его конца.
 struct InteractionEvent {
-    std::shared_ptr<NPC> actor;
-    std::shared_ptr<NPC> target;
+    static constexpr NPCHandle NONE{UINT32_MAX, 0};
+
+    NPCHandle actor{NONE};
+    NPCHandle target{NONE};
+
+    InteractionEvent() = default;
+    InteractionEvent(NPCHandle a, NPCHandle t) : actor(a), target(t) {}
+    InteractionEvent(const std::shared_ptr<NPC> &a, const std::shared_ptr<NPC> &t)
+        : actor(a ? a->handle : NONE), target(t ? t->handle : NONE) {}
+};
+
+enum class OverflowPolicy {
+    DropOldest,     // вытеснить самое старое событие
+    CoalescePair,   // не ставить пару, которая уже ждёт в очереди (best-effort)
+    BlockProducer   // ждать, пока освободится место
+};
+
+struct QueueStats {
+    size_t depth;
+    size_t capacity;
+    size_t pushed;
+    size_t dropped;
+    size_t coalesced;
+    size_t high_water;
 };
 
 class InteractionManager {
 public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+    static constexpr size_t BATCH_SIZE = 256;
+
     static InteractionManager& instance();
 
-    void push(InteractionEvent ev);
-    void apply_outcome(const std::shared_ptr<NPC>& actor,
-                   const std::shared_ptr<NPC>& target,
+    // вызывать до запуска потока обработки
+    void configure(size_t capacity, OverflowPolicy policy);
+    QueueStats stats() const;
+
+    bool push(InteractionEvent ev);
+    void apply_outcome(NPC& actor, NPC& target,
                    InteractionOutcome outcome);
+    // 0 или 1 - всё разрешается в потоке обработки; вызывать до его запуска
+    void set_workers(size_t workers);
+    // события разрешаются строго по порядку очереди в одном потоке
+    void set_deterministic(bool on);
+
+    // обработать до max_events событий в текущем потоке
+    size_t drain(size_t max_events = BATCH_SIZE);
+    // Разрешить события напрямую, минуя очередь: с pool - параллельно,
+    // без него - по порядку. Кости события i берутся из потока
+    // (Dice, round, i), так что при последовательном разрешении итог
+    // зависит только от сида, round и порядка событий. Наблюдатели
+    // вызываются под NPCWorld::guard пары: уничтожать из них NPC нельзя.
+    void resolve_batch(const std::vector<InteractionEvent>& events, WorkerPool* pool = nullptr,
+                       uint64_t round = 0);
     void operator()();
     void stop();
 
 private:
-    InteractionManager() = default;
-    std::queue<InteractionEvent> queue;
-    std::mutex mtx;
+    InteractionManager();
+    bool pop(InteractionEvent& ev);
+    static uint64_t pair_key(const InteractionEvent& ev);
+    bool mark_pending(uint64_t key);
+    void clear_pending(uint64_t key);
+    void resolve(const InteractionEvent& ev, RandomStream& dice);
+    void resolve_locked(const InteractionEvent& ev, RandomStream& dice);
+    void wait_for_work();
+    void wait_for_space();
+
+    std::unique_ptr<MPSCQueue<InteractionEvent>> queue;
+    std::unique_ptr<std::atomic<uint64_t>[]> pending;
+    size_t pending_mask{0};
+    OverflowPolicy policy{OverflowPolicy::CoalescePair};
+
+    std::atomic<size_t> pushed{0};
+    std::atomic<size_t> dropped{0};
+    std::atomic<size_t> coalesced{0};
+    std::atomic<size_t> high_water{0};
     std::atomic<bool> running{true};
+
+    std::mutex wait_mtx;
+    std::condition_variable work_cv;
+    std::condition_variable space_cv;
+    std::atomic<bool> consumer_parked{false};
+    std::atomic<size_t> producers_blocked{0};
+    std::vector<InteractionEvent> batch;
+
+    std::unique_ptr<WorkerPool> pool;
+    bool deterministic{false};
+    uint64_t drained{0};        // номер пачки drain для костей
 };
 
 // ---------------- Вспомогательные функции ----------------
-void save_all(const std::vector<std::shared_ptr<NPC>> &list, const std::string &filename);
+enum class SaveFormat {
+    Text,       // строка на NPC, без alive
+    Binary      // снимок из snapshot.h
+};
+
+void save_all(const std::vector<std::shared_ptr<NPC>> &list, const std::string &filename,
+              SaveFormat format = SaveFormat::Text);
+// формат определяется по содержимому файла
 std::vector<std::shared_ptr<NPC>> load_all(const std::string &filename);
 void print_all(const std::vector<std::shared_ptr<NPC>> &list);
 void print_survivors(const std::vector<std::shared_ptr<NPC>>& npcs);
+void print_survivors(const WorldFrame& frame);
 void draw_map(const std::vector<std::shared_ptr<NPC>>& list);
+// с пулом растеризация делится между потоками, результат тот же
+void draw_map(const NPCWorld& world, WorkerPool* pool = nullptr);
+// кадр неизменяем, поэтому рисуется без блокировок и без разрывов
+void draw_map(const WorldFrame& frame);
+// своим рендерером: другой размер карты или режим Diff
+void draw_map(const WorldFrame& frame, MapRenderer& renderer);
+// тепловая карта по счётчикам, O(клеток); рендерер того же размера, что map
+void draw_heatmap(const DensityMap& map, HeatMode mode = HeatMode::Density);
+void draw_heatmap(const DensityMap& map, MapRenderer& renderer, HeatMode mode = HeatMode::Density);
+// из rng() текущего потока
 NPCType random_type();
 int random_coord(int min, int max);
-std::mt19937& rng();
-int roll();
@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+
+// ---------------- Отрисовка карты ----------------
+// Карта cols x rows клеток собирается в один заранее выделенный буфер
+// и выводится одним write. Escape-последовательность цвета пишется
+// только там, где цвет меняется. В режиме Diff первый кадр очищает
+// экран, а следующие перерисовывают на месте только изменившиеся
+// клетки, так что время кадра зависит от числа изменений, а не от
+// размера карты.
+enum class RenderMode {
+    Full,       // каждый кадр целиком, дописывается в поток
+    Diff        // карта в левом верхнем углу экрана, только изменения
+};
+
+class MapRenderer {
+public:
+    MapRenderer(int cols, int rows, int world_x, int world_y, RenderMode mode = RenderMode::Full);
+
+    int cols() const { return w; }
+    int rows() const { return h; }
+    // клетка для точки мира, с прижатием к краю
+    size_t cell_of(int x, int y) const;
+
+    void clear();
+    // позже поставленный NPC закрывает раньше поставленного
+    void put(NPCType t, int x, int y, bool alive);
+    // произвольный символ в клетку; color - цвет типа или без цвета
+    void set(size_t cell, char symbol, NPCType color);
+    void set(size_t cell, char symbol);
+
+    // собрать кадр в буфер; в режиме Diff кадр запоминается как показанный
+    const std::string& compose();
+    // compose и один write в fd
+    bool present(int fd = 1);
+    // клеток в последнем кадре, которые пришлось вывести
+    size_t changed() const { return emitted; }
+
+private:
+    void compose_full();
+    void compose_diff();
+    void set_color(uint16_t glyph);
+    void put_glyph(uint16_t glyph);
+
+    int w, h;
+    int world_x, world_y;
+    RenderMode mode;
+
+    // символ в младшем байте, в старшем 0 - без цвета, иначе тип + 1
+    std::vector<uint16_t> cells;
+    std::vector<uint16_t> shown;
+    bool has_shown{false};
+    int color{-1};              // текущий цвет вывода: -1 - сброшен
+    size_t emitted{0};
+    std::string buf;
+};
@@ -0,0 +1,167 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+
+// ---------------- Метрики ----------------
+// Таймеры областей кода, счётчики и гистограммы задержек. Каждый поток
+// пишет в свой набор атомиков без RMW и без блокировок (писатель у
+// набора один), metrics_snapshot() складывает наборы всех потоков.
+// В сборке без METRICS (опция CMake, включена по умолчанию) макросы
+// METRIC_* не оставляют в коде ничего, а снимки нулевые:
+//   METRIC_SCOPE(Timer::DrawMap);    до конца блока
+//   METRIC_COUNT(Counter::Kills, 1);
+enum class Timer : uint8_t {
+    Move,           // фазы Engine::step, в порядке Phase
+    Detect,
+    Resolve,
+    Observe,
+    Tick,           // Engine::step целиком
+    Drain,          // пачка InteractionManager::drain в потоке обработки
+    Observers,      // доставка пачки EventBus::flush
+    DrawMap,
+    LockWait,       // ожидание занятого замка, быстрый захват не пишется
+};
+constexpr size_t TIMER_COUNT = 9;
+
+enum class Counter : uint8_t {
+    Events,         // разобранные события взаимодействия
+    Kills,
+    Escapes,
+    Heals,
+};
+constexpr size_t COUNTER_COUNT = 4;
+
+const char* timer_name(Timer t);
+const char* counter_name(Counter c);
+
+// Логарифмически-линейная гистограмма, как HDR: на каждую степень двойки
+// 2^SUB_BITS корзин, ошибка значения не больше 1/2^SUB_BITS.
+struct LatencyHistogram {
+    static constexpr unsigned SUB_BITS = 3;
+    static constexpr uint64_t SUB = 1u << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t count{0};
+    uint64_t total_ns{0};
+
+    static size_t bucket(uint64_t ns);
+    static uint64_t lower(size_t b);    // наименьшее значение корзины
+    static uint64_t upper(size_t b);    // наибольшее
+
+    void record(uint64_t ns);
+    // верхняя граница корзины, в которую попал квантиль q из [0, 1]
+    uint64_t percentile(double q) const;
+    uint64_t max() const;
+    double mean() const { return count ? double(total_ns) / count : 0; }
+
+    LatencyHistogram& operator-=(const LatencyHistogram &o);
+};
+
+struct MetricsSnapshot {
+    std::chrono::steady_clock::time_point at;
+    std::array<LatencyHistogram, TIMER_COUNT> timers;
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+    uint64_t queue_depth{0};        // последнее значение
+    uint64_t queue_high_water{0};
+
+    const LatencyHistogram& timer(Timer t) const { return timers[size_t(t)]; }
+    uint64_t counter(Counter c) const { return counters[size_t(c)]; }
+
+    // приращение с прошлого снимка; глубина очереди остаётся текущей
+    MetricsSnapshot operator-(const MetricsSnapshot &o) const;
+};
+
+bool metrics_enabled();
+MetricsSnapshot metrics_snapshot();
+// наборов счётчиков в реестре: столько потоков писали метрики одновременно
+size_t metrics_thread_sets();
+// отчёт о приращении d за seconds: частоты, задержки, очередь
+std::string format_metrics(const MetricsSnapshot &d, double seconds);
+
+namespace metrics {
+void record(Timer t, uint64_t ns);
+void count(Counter c, uint64_t n = 1);
+void queue_depth(size_t depth);
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer t) : timer(t), t0(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        auto d = std::chrono::steady_clock::now() - t0;
+        record(timer, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Timer timer;
+    std::chrono::steady_clock::time_point t0;
+};
+
+// lock() с учётом ожидания в Timer::LockWait
+template <typename Mutex>
+void lock(Mutex &m) {
+#ifdef GAME_METRICS
+    if (m.try_lock()) return;
+    ScopedTimer wait(Timer::LockWait);
+    m.lock();
+#else
+    m.lock();
+#endif
+}
+}
+
+#ifdef GAME_METRICS
+#define METRIC_CAT_(a, b) a##b
+#define METRIC_CAT(a, b) METRIC_CAT_(a, b)
+#define METRIC_SCOPE(t) ::metrics::ScopedTimer METRIC_CAT(metric_scope_, __LINE__)(t)
+#define METRIC_TIME(t, ns) ::metrics::record((t), (ns))
+#define METRIC_COUNT(c, n) ::metrics::count((c), (n))
+#define METRIC_QUEUE_DEPTH(d) ::metrics::queue_depth(d)
+#else
+#define METRIC_SCOPE(t) ((void)0)
+#define METRIC_TIME(t, ns) ((void)0)
+#define METRIC_COUNT(c, n) ((void)0)
+#define METRIC_QUEUE_DEPTH(d) ((void)0)
+#endif
+
+// ---------------- Периодический отчёт ----------------
+// Фоновый поток раз в interval пишет format_metrics за прошедший
+// интервал в файл (дописывая) или, при пустом имени, в stderr. В сборке
+// без METRICS ничего не делает: поток не запускается, файл не создаётся.
+class MetricsReporter {
+public:
+    explicit MetricsReporter(const std::string &filename = "",
+                             std::chrono::milliseconds interval = std::chrono::seconds(1));
+    ~MetricsReporter();
+
+    MetricsReporter(const MetricsReporter&) = delete;
+    MetricsReporter& operator=(const MetricsReporter&) = delete;
+
+    // отчёт за время с прошлого отчёта прямо сейчас
+    void report();
+    void stop();
+
+private:
+    void loop();
+
+    std::chrono::milliseconds interval;
+    std::ofstream file;
+    bool to_file{false};
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping{false};
+    MetricsSnapshot last;
+    std::thread worker;
+};
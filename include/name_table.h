@@ -0,0 +1,48 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <string_view>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+enum class NPCType;
+
+// ---------------- Имена NPC ----------------
+// NPC хранит 32-битный NameId вместо строки. Имя вида <тип>_<n>, какие
+// раздаёт main, кодируется одним номером и собирается только при печати:
+// префикс - имя типа из TypeRegistry на момент печати. Остальные имена
+// один раз кладутся в общий пул, одинаковые делят запись. Пул только
+// растёт, поэтому string_view на его строки не протухают.
+using NameId = uint32_t;
+
+class NameTable {
+public:
+    static constexpr NameId EMPTY = 0;
+    static constexpr NameId NUMBERED = 1u << 31;    // бит номерного имени
+
+    static NameTable& instance();
+
+    // номерное имя <тип>_<n>; n < NUMBERED
+    static constexpr NameId numbered(uint32_t n) { return NUMBERED | n; }
+    static constexpr bool is_numbered(NameId id) { return id & NUMBERED; }
+
+    // <тип>_<n> без ведущих нулей становится номером, остальное - в пул
+    NameId intern(NPCType type, std::string_view name);
+
+    // номерное имя собирается в scratch, из пула - отдаётся как есть
+    std::string_view view(NameId id, NPCType type, std::string &scratch) const;
+    std::string str(NameId id, NPCType type) const;
+
+    size_t size() const;        // строк в пуле, с пустой
+    size_t bytes() const;       // символов в пуле
+
+private:
+    NameTable();
+
+    mutable std::shared_mutex mtx;
+    std::deque<std::string> strings;    // [EMPTY] - пустое имя
+    std::unordered_map<std::string_view, NameId> index;
+    size_t chars{0};
+};
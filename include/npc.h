@@ -4,11 +4,16 @@
 #include <vector>
 #include <iostream>
 #include <shared_mutex>
+#include <cstdint>
+#include <span>
+#include "npc_world.h"
+#include "name_table.h"
 
 struct Orc;
 struct Squirrel;
 struct Bear;
 struct Druid;
+struct NPC;
 
 enum class NPCType {
     Unknown = 0,
@@ -30,39 +35,57 @@ struct IInteractionVisitor {
     virtual InteractionOutcome visit(Squirrel &target) = 0;
     virtual InteractionOutcome visit(Bear &target) = 0;
     virtual InteractionOutcome visit(Druid &target) = 0;
+    // типы из TypeRegistry без своего класса
+    virtual InteractionOutcome visit(NPC &) { return InteractionOutcome::NoInteraction; }
     virtual ~IInteractionVisitor() = default;
 };
 
+// Событие из пачки EventBus: NPC по дескрипторам, положения на момент
+// события. Пока пачка доставляется, NPC по дескрипторам ещё живы, если
+// их не освободили в том же тике.
+struct InteractionRecord {
+    NPCHandle actor;
+    NPCHandle target;
+    int ax, ay;
+    int tx, ty;
+    NPCType actor_type;
+    NPCType target_type;
+    InteractionOutcome outcome;
+};
+
+// NPC передаются ссылками: на время вызова оба живы, хранить их нельзя
 struct IInteractionObserver {
-    virtual void on_interaction(const std::shared_ptr<class NPC> &actor,
-                          const std::shared_ptr<class NPC> &target,
+    virtual void on_interaction(const NPC &actor, const NPC &target,
                           InteractionOutcome outcome) = 0;
+    // пачка от EventBus; по умолчанию on_interaction на каждое событие,
+    // освобождённые NPC пропускаются
+    virtual void on_batch(std::span<const InteractionRecord> events);
     virtual ~IInteractionObserver() = default;
 };
 
 struct NPC : public std::enable_shared_from_this<NPC> {
-    mutable std::mutex mtx;
     NPCType type{NPCType::Unknown};
-    std::string name;
-    int x{0};
-    int y{0};
-    bool alive{true};
+    NameId name_id{NameTable::EMPTY};
+    NPCHandle handle;
     std::vector<std::shared_ptr<IInteractionObserver>> observers;
 
-    NPC() = default;
+    NPC();
     NPC(NPCType t, std::string_view nm, int x_, int y_);
-    virtual ~NPC() = default;
+    virtual ~NPC();
+
+    NPC(const NPC&) = delete;
+    NPC& operator=(const NPC&) = delete;
 
     virtual InteractionOutcome accept(IInteractionVisitor &visitor) = 0;
 
     void subscribe(const std::shared_ptr<IInteractionObserver> &obs);
-    void notify_interaction(const std::shared_ptr<NPC> &target, InteractionOutcome outcome);
+    void notify_interaction(const NPC &target, InteractionOutcome outcome) const;
 
     virtual void save(std::ostream &os) const;
 
     virtual void print(std::ostream &os) const;
 
-    bool is_close(const std::shared_ptr<NPC> &other, int distance) const;
+    bool is_close(const NPC &other, int distance) const;
     
     void move(int shift_x, int shift_y, int max_x, int max_y);
 
@@ -70,13 +93,22 @@ struct NPC : public std::enable_shared_from_this<NPC> {
     void must_die();
     void heal();
     std::pair<int,int> position() const;
+    // имя из NameTable; номерное собирается в scratch, без кучи при повторах
+    std::string name() const;
+    std::string_view name(std::string &scratch) const;
     std::string get_color(NPCType t) const;
     int get_move_distance() const;
     int get_interaction_distance() const;
     bool get_state(int& x_, int& y_) const;
 };
 
-std::string type_to_string(NPCType t);
+// имя и цвет из TypeRegistry
+const std::string& type_to_string(NPCType t);
+const std::string& type_color(NPCType t);
+int move_distance(NPCType t);
+int interaction_distance(NPCType t);
 
 std::shared_ptr<NPC> createNPC(NPCType type, const std::string &name, int x, int y);
+// имя <тип>_<number> без строки
+std::shared_ptr<NPC> createNPC(NPCType type, uint32_t number, int x, int y);
 std::shared_ptr<NPC> createNPCFromStream(std::istream &is);
@@ -0,0 +1,185 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+enum class NPCType;
+struct NPC;
+class SpatialGrid;
+class DensityMap;
+
+// ---------------- Хранилище NPC ----------------
+// Горячие поля (x, y, alive, type) лежат столбцами в блоках по CHUNK
+// элементов, холодные (имя, наблюдатели, виртуальный accept) остаются
+// в объекте NPC. Блоки не перемещаются, поэтому индекс слота стабилен,
+// а поколение в NPCHandle отличает новый NPC от освободившего слот.
+// x, y и alive упакованы в одно атомарное слово: читатель без
+// блокировок всегда видит согласованную тройку, а move, set_alive и
+// place меняют её одной атомарной операцией.
+struct NPCHandle {
+    uint32_t index{0};
+    uint32_t generation{0};
+
+    bool operator==(const NPCHandle&) const = default;
+};
+
+struct NPCState {
+    int x;
+    int y;
+    bool alive;
+
+    // биты 0..31 - x, 32..62 - y (31 бит со знаком), 63 - alive
+    static constexpr uint64_t ALIVE = uint64_t(1) << 63;
+
+    static constexpr uint64_t pack(int x, int y, bool alive) {
+        return uint64_t(uint32_t(x)) | uint64_t(uint32_t(y) & 0x7FFFFFFF) << 32 | (alive ? ALIVE : 0);
+    }
+    static constexpr NPCState unpack(uint64_t w) {
+        return {int32_t(uint32_t(w)), int32_t(uint32_t(w >> 32) << 1) >> 1, (w & ALIVE) != 0};
+    }
+};
+
+class NPCWorld {
+public:
+    static constexpr uint32_t CHUNK_BITS = 12;
+    static constexpr uint32_t CHUNK = 1u << CHUNK_BITS;
+    static constexpr uint32_t MAX_CHUNKS = 1024;
+
+    static NPCWorld& instance();
+
+    NPCWorld() = default;
+    ~NPCWorld();
+    NPCWorld(const NPCWorld&) = delete;
+    NPCWorld& operator=(const NPCWorld&) = delete;
+
+    NPCHandle spawn(NPC *owner, NPCType type, int x, int y);
+    // ждёт замок слота: NPC не освобождается, пока его держит guard
+    void release(NPCHandle h);
+    bool valid(NPCHandle h) const;
+    NPC* get(NPCHandle h) const;
+
+    // Замки слотов полосами по индексу. Кто нашёл NPC через get() под
+    // guard(index), может пользоваться им до отпускания замка: ~NPC
+    // зовёт release и ждёт. Освобождать NPC под его же guard нельзя.
+    static constexpr size_t GUARD_STRIPES = 256;
+    std::mutex& guard(uint32_t i) const { return guards[i % GUARD_STRIPES]; }
+
+    // верхняя граница индексов и число занятых слотов
+    uint32_t slots() const { return used_slots.load(std::memory_order_acquire); }
+    size_t size() const;
+    // растёт при каждом spawn и release
+    uint64_t membership() const { return members.load(std::memory_order_acquire); }
+
+    // доступ по индексу; состояние читается и пишется без блокировок
+    NPC* owner(uint32_t i) const { return chunk(i).owner[i & MASK].load(std::memory_order_acquire); }
+    int x(uint32_t i) const { return state(i).x; }
+    int y(uint32_t i) const { return state(i).y; }
+    NPCType type(uint32_t i) const { return chunk(i).type[i & MASK]; }
+    uint32_t generation(uint32_t i) const {
+        return chunk(i).generation[i & MASK].load(std::memory_order_acquire);
+    }
+
+    NPCState state(uint32_t i) const {
+        return NPCState::unpack(chunk(i).state[i & MASK].load(std::memory_order_acquire));
+    }
+    // CAS: сдвиг не теряет одновременную смерть или лечение
+    void move(uint32_t i, int shift_x, int shift_y, int max_x, int max_y);
+    // сдвиги по индексу слота, размер не меньше slots()
+    void move_all(const std::vector<int> &shift_x, const std::vector<int> &shift_y,
+                  int max_x, int max_y);
+    void set_alive(uint32_t i, bool value);
+    // поставить NPC в точку без проверки границ
+    void place(uint32_t i, int x, int y);
+
+    // f(i) для каждого занятого слота по возрастанию индекса;
+    // spawn/release во время обхода не допускаются
+    template <typename F>
+    void for_each(F &&f) const;
+
+    // f(i) для каждого слота, который с прошлого вызова двигался, умирал,
+    // оживал, занимался или освобождался; отметки при этом снимаются.
+    // Обходит только изменившиеся слова битовой карты, а не весь мир.
+    // Читатель отметок должен быть один.
+    template <typename F>
+    void drain_dirty(F &&f);
+
+    // Сетки и карты плотности, которым сообщаются сдвиги, смерти, рождения
+    // и уходы; их может быть несколько (движок, бенчмарк, тест). track и
+    // untrack идут под alloc_mtx, но move, move_all, set_alive и place
+    // читают списки без блокировок: подписывать и отписывать можно только
+    // между тиками, пока никто не двигает NPC.
+    void track(SpatialGrid *g);
+    void untrack(SpatialGrid *g);
+    void track(DensityMap *d);
+    void untrack(DensityMap *d);
+
+private:
+    static constexpr uint32_t MASK = CHUNK - 1;
+
+    struct Chunk {
+        std::atomic<uint64_t> state[CHUNK];     // NPCState::pack
+        NPCType type[CHUNK];
+        // атомарны: get() по устаревшему дескриптору читает их без
+        // alloc_mtx, пока spawn занимает освободившийся слот
+        std::atomic<uint32_t> generation[CHUNK];
+        std::atomic<NPC*> owner[CHUNK];     // публикуется последним
+        std::atomic<uint64_t> dirty[CHUNK / 64];
+    };
+
+    // бит сводки на каждое слово dirty, где есть отметки
+    static constexpr size_t DIRTY_WORDS = size_t(MAX_CHUNKS) * CHUNK / 64;
+
+    void mark_dirty(uint32_t i) { mark_dirty_bits(i >> 6, uint64_t(1) << (i & 63)); }
+    void mark_dirty_bits(uint32_t word, uint64_t bits);
+
+    Chunk& chunk(uint32_t i) const {
+        return *chunks[i >> CHUNK_BITS].load(std::memory_order_acquire);
+    }
+
+    std::array<std::atomic<Chunk*>, MAX_CHUNKS> chunks{};
+    std::atomic<uint32_t> used_slots{0};
+    std::array<std::atomic<uint64_t>, DIRTY_WORDS / 64> dirty_summary{};
+    std::vector<uint32_t> free_slots;   // куча: spawn берёт наименьший слот
+    size_t live{0};
+    std::atomic<uint64_t> members{0};
+    mutable std::mutex alloc_mtx;
+    mutable std::array<std::mutex, GUARD_STRIPES> guards;
+    std::vector<SpatialGrid*> grids;
+    std::vector<DensityMap*> densities;
+};
+
+template <typename F>
+void NPCWorld::for_each(F &&f) const {
+    uint32_t n = slots();
+    for (uint32_t base = 0; base < n; base += CHUNK) {
+        const Chunk &c = chunk(base);
+        uint32_t end = n - base < CHUNK ? n - base : CHUNK;
+        for (uint32_t k = 0; k < end; ++k)
+            if (c.owner[k].load(std::memory_order_acquire)) f(base + k);
+    }
+}
+
+template <typename F>
+void NPCWorld::drain_dirty(F &&f) {
+    size_t summary_words = (size_t(slots()) + 4095) / 4096;
+    for (size_t s = 0; s < summary_words; ++s) {
+        if (!dirty_summary[s].load(std::memory_order_relaxed)) continue;
+        uint64_t words = dirty_summary[s].exchange(0, std::memory_order_acq_rel);
+
+        while (words) {
+            uint32_t word = static_cast<uint32_t>(s * 64 + __builtin_ctzll(words));
+            words &= words - 1;
+
+            uint32_t base = word * 64;
+            uint64_t bits = chunk(base).dirty[(base & MASK) >> 6].exchange(0, std::memory_order_acq_rel);
+            while (bits) {
+                f(base + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+}
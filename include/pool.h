@@ -0,0 +1,64 @@
+#pragma once
+#include <mutex>
+#include <new>
+#include <vector>
+#include <cstddef>
+
+// ---------------- Пулы объектов ----------------
+// FixedPool раздаёт блоки одного размера из плит по per_slab блоков и
+// держит освобождённые блоки в списке; плиты возвращаются в кучу только
+// вместе с пулом. PoolAllocator<T> даёт каждому T свой пул, который не
+// разрушается до конца процесса: createNPC кладёт через него NPC вместе
+// с блоком управления shared_ptr, и после прогрева рождение и смерть
+// NPC обходятся без кучи.
+class FixedPool {
+public:
+    FixedPool(size_t size, size_t align, size_t per_slab = 256);
+    ~FixedPool();
+
+    FixedPool(const FixedPool&) = delete;
+    FixedPool& operator=(const FixedPool&) = delete;
+
+    void* allocate();
+    void deallocate(void *p);
+
+    size_t block_size() const { return block; }
+    size_t slabs() const;
+    size_t in_use() const;
+
+private:
+    struct Free { Free *next; };
+
+    size_t block, align, per_slab;
+    mutable std::mutex mtx;
+    Free *head{nullptr};
+    size_t used{0};
+    std::vector<void*> slab_mem;
+};
+
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    static FixedPool& pool() {
+        // не разрушается: NPC в статических объектах могут пережить пул
+        static FixedPool *p = new FixedPool(sizeof(T), alignof(T));
+        return *p;
+    }
+
+    T* allocate(size_t n) {
+        if (n == 1) return static_cast<T*>(pool().allocate());
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+    }
+    void deallocate(T *p, size_t n) {
+        if (n == 1) pool().deallocate(p);
+        else        ::operator delete(p, std::align_val_t(alignof(T)));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+};
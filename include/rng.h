@@ -0,0 +1,97 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// ---------------- Случайные числа ----------------
+// Philox4x32-10: блок из четырёх 32-битных чисел - чистая функция от
+// 128-битного счётчика и 64-битного ключа. Поток не хранит таблиц,
+// создаётся за пару присваиваний и зависит только от (сид, вид, a, b),
+// поэтому у каждого NPC на каждом тике может быть свой поток, и
+// результат не зависит от того, какой поток ОС его посчитал.
+namespace philox {
+using Counter = std::array<uint32_t, 4>;
+using Key = std::array<uint32_t, 2>;
+
+inline constexpr uint32_t M0 = 0xD2511F53;
+inline constexpr uint32_t M1 = 0xCD9E8D57;
+inline constexpr uint32_t W0 = 0x9E3779B9;
+inline constexpr uint32_t W1 = 0xBB67AE85;
+
+inline Counter block(Counter c, Key k) {
+    for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = uint64_t(M0) * c[0];
+        uint64_t p1 = uint64_t(M1) * c[2];
+        c = {uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1),
+             uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)};
+        k[0] += W0;
+        k[1] += W1;
+    }
+    return c;
+}
+}
+
+// разные виды потоков не пересекаются даже при одинаковых a и b
+enum class StreamKind : uint32_t {
+    Thread,     // rng() потока: a - номер потока
+    Move,       // сдвиг в Engine: a - тик, b - слот NPC
+    Dice,       // кости боя: a - тик или номер пачки, b - номер события
+    User        // для тестов и своих нужд
+};
+
+class RandomStream {
+public:
+    using result_type = uint32_t;
+
+    RandomStream() = default;
+    // поток от текущего глобального сида
+    RandomStream(StreamKind kind, uint64_t a, uint32_t b = 0);
+    RandomStream(uint64_t seed, StreamKind kind, uint64_t a, uint32_t b = 0)
+        : key{uint32_t(seed), uint32_t(seed >> 32)},
+          ctr{0, b, uint32_t(a), (uint32_t(a >> 32) & 0x00FFFFFF) | (uint32_t(kind) << 24)} {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+    result_type operator()() {
+        if (used == 4) refill();
+        return buf[used++];
+    }
+
+    // равномерно в [lo, hi], одинаково на любой платформе
+    int uniform(int lo, int hi) {
+        if (hi <= lo) return lo;
+        uint64_t range = uint64_t(int64_t(hi) - lo) + 1;
+        if (range > max()) return static_cast<int>(int64_t(lo) + (*this)());
+
+        // Lemire: умножение вместо деления, отбрасываются только хвосты
+        uint64_t m = uint64_t((*this)()) * range;
+        if (uint32_t(m) < range) {
+            uint32_t threshold = uint32_t(-range) % uint32_t(range);
+            while (uint32_t(m) < threshold)
+                m = uint64_t((*this)()) * range;
+        }
+        return static_cast<int>(int64_t(lo) + int64_t(m >> 32));
+    }
+
+private:
+    void refill() {
+        buf = philox::block(ctr, key);
+        ++ctr[0];
+        used = 0;
+    }
+
+    philox::Key key{};
+    philox::Counter ctr{};      // ctr[0] - номер блока внутри потока
+    philox::Counter buf{};
+    unsigned used{4};
+};
+
+// Сид по умолчанию - 0. Новый сид сбрасывает и потоки rng() всех
+// потоков: следующий вызов в каждом начнёт его поток заново.
+void set_seed(uint64_t seed);
+uint64_t seed();
+
+// поток текущего потока ОС; номера раздаются по первому обращению
+RandomStream& rng();
+// 1..6 из rng()
+int roll();
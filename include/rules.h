@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "npc.h"
+#include "rng.h"
+
+// ---------------- Правила взаимодействия ----------------
+// Кто кого убивает и лечит, задано таблицей NPCType x NPCType. Здесь
+// встроенные типы, собранные при компиляции; с них начинается
+// TypeRegistry (type_registry.h), а файл настроек может их поменять и
+// добавить новые типы. Разбор события берёт правило из реестра по двум
+// типам из NPCWorld, без виртуальных вызовов.
+constexpr size_t NPC_TYPES = 5;         // встроенные, индекс - NPCType
+
+// Шанс убийства задаётся в 36-х долях - исходах броска двух кубиков.
+// CONTEST - атакующий выбрасывает строго больше защитника, 15 из 36.
+constexpr int DICE_OUTCOMES = 36;
+constexpr uint8_t CONTEST = 15;
+
+struct TypeRule {
+    int move;           // шаг за тик по каждой оси
+    int reach;          // дальность взаимодействия
+};
+
+struct PairRule {
+    uint8_t kill;       // шанс убить живую цель, из DICE_OUTCOMES; 0 - не нападает
+    bool heal;          // поднимает мёртвую цель
+};
+
+struct TypeLook {
+    std::string_view name;
+    char symbol;        // на карте
+    std::string_view color;
+};
+
+inline constexpr std::array<TypeLook, NPC_TYPES> TYPE_LOOKS{{
+    /* Unknown  */ {"Unknown", '?', "\033[35m"},
+    /* Orc      */ {"Orc", 'O', "\033[31m"},
+    /* Squirrel */ {"Squirrel", 'S', "\033[32m"},
+    /* Bear     */ {"Bear", 'B', "\033[33m"},
+    /* Druid    */ {"Druid", 'D', "\033[36m"},
+}};
+
+inline constexpr std::array<TypeRule, NPC_TYPES> TYPE_RULES{{
+    /* Unknown  */ {0, 0},
+    /* Orc      */ {20, 10},
+    /* Squirrel */ {5, 5},
+    /* Bear     */ {5, 10},
+    /* Druid    */ {10, 10},
+}};
+
+namespace rule {
+inline constexpr PairRule NONE{0, false};
+inline constexpr PairRule KILL{CONTEST, false};
+inline constexpr PairRule HEAL{0, true};
+}
+
+// строка - действующий, столбец - цель
+inline constexpr std::array<std::array<PairRule, NPC_TYPES>, NPC_TYPES> PAIR_RULES{{
+    //              Unknown     Orc         Squirrel    Bear        Druid
+    /* Unknown  */ {{rule::NONE, rule::NONE, rule::NONE, rule::NONE, rule::NONE}},
+    /* Orc      */ {{rule::NONE, rule::KILL, rule::NONE, rule::KILL, rule::KILL}},
+    /* Squirrel */ {{rule::NONE, rule::NONE, rule::NONE, rule::NONE, rule::NONE}},
+    /* Bear     */ {{rule::NONE, rule::NONE, rule::KILL, rule::NONE, rule::NONE}},
+    /* Druid    */ {{rule::NONE, rule::NONE, rule::HEAL, rule::HEAL, rule::NONE}},
+}};
+
+constexpr const TypeRule& type_rule(NPCType t) {
+    return TYPE_RULES[static_cast<size_t>(t) % NPC_TYPES];
+}
+
+constexpr const PairRule& pair_rule(NPCType actor, NPCType target) {
+    return PAIR_RULES[static_cast<size_t>(actor) % NPC_TYPES][static_cast<size_t>(target) % NPC_TYPES];
+}
+
+static_assert(pair_rule(NPCType::Orc, NPCType::Bear).kill == CONTEST);
+static_assert(!pair_rule(NPCType::Bear, NPCType::Orc).kill);
+static_assert(pair_rule(NPCType::Druid, NPCType::Squirrel).heal);
+static_assert(type_rule(NPCType::Squirrel).reach == 5);
+
+// Живой действующий против живой цели; бросок только если правило нападает
+inline InteractionOutcome attack_outcome(const PairRule &r, RandomStream &dice = rng()) {
+    if (!r.kill) return InteractionOutcome::NoInteraction;
+    return dice.uniform(0, DICE_OUTCOMES - 1) < r.kill ? InteractionOutcome::TargetKilled
+                                                        : InteractionOutcome::TargetEscaped;
+}
+
+inline InteractionOutcome support_outcome(const PairRule &r, bool target_alive) {
+    return r.heal && !target_alive ? InteractionOutcome::TargetHealed
+                                   : InteractionOutcome::NoInteraction;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ---------------- Пакетные ядра ----------------
+// Реализация выбирается при первом вызове по возможностям процессора.
+// Векторная и скалярная версии дают одинаковый результат бит в бит.
+enum class SimdLevel {
+    Scalar,
+    AVX2
+};
+
+SimdLevel simd_level();
+// для тестов и бенчмарков; уровень выше поддерживаемого игнорируется
+void force_simd_level(SimdLevel level);
+const char* simd_level_name(SimdLevel level);
+
+// Как NPCWorld::move для n слотов сразу, над упакованными словами
+// состояния (NPCState::pack: x - биты 0..31, y - 32..62, alive - 63):
+// next[k] - state[k] со сдвигом, который применяется по оси, только если
+// координата остаётся в [0, max]. state и next могут совпадать.
+void move_batch(const uint64_t *state, uint64_t *next, const int *dx, const int *dy,
+                size_t n, int max_x, int max_y);
+
+// out[k] = 1, если (bx[k], by[k]) не дальше max(r, br[k]) от (ax, ay).
+// Координаты и радиусы лежат в [0, 32768).
+void range_mask(int ax, int ay, int r,
+                const int *bx, const int *by, const int *br,
+                size_t n, uint8_t *out);
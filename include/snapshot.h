@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+#include "world_frame.h"
+
+// ---------------- Двоичный снимок мира ----------------
+// Заголовок, затем столбцы type, alive, x, y, слоты NPCWorld (с версии 2),
+// смещения имён (count + 1) и таблица имён подряд. Столбцы type, alive,
+// x и смещения имён начинаются с границы 8 байт, y и слоты идут вплотную
+// за x, на границе 4 байт - своего размера элемента. Поэтому загрузка
+// отображает файл в память и читает столбцы напрямую.
+namespace snapshot {
+
+constexpr char MAGIC[8] = {'N', 'P', 'C', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t VERSION = 2;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t names_size;
+    uint64_t tag;           // метка для связи с файлом дельт, см. checkpoint.h
+};
+
+static_assert(sizeof(Header) == 32);
+
+// смещения столбцов от начала файла
+struct Layout {
+    size_t types;
+    size_t alive;
+    size_t xs;
+    size_t ys;
+    size_t slots;
+    size_t name_offsets;
+    size_t names;
+    size_t total;
+};
+
+Layout layout(uint32_t version, uint32_t count, uint64_t names_size);
+
+} // namespace snapshot
+
+struct SnapshotInfo {
+    uint64_t tag{0};
+    std::vector<uint32_t> slots;    // слот каждого NPC при сохранении; пусто для версии 1
+};
+
+bool is_snapshot(const std::string &filename);
+bool save_snapshot(const std::vector<std::shared_ptr<NPC>> &list, const std::string &filename);
+bool save_snapshot(const std::vector<const NPC*> &npcs, const std::string &filename, uint64_t tag = 0);
+// из опубликованного кадра, не трогая живых NPC
+bool save_snapshot(const WorldFrame &frame, const std::string &filename, uint64_t tag = 0);
+// пустой список, если файл не открылся или повреждён
+std::vector<std::shared_ptr<NPC>> load_snapshot(const std::string &filename, SnapshotInfo *info = nullptr);
@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+#include "simd_kernels.h"
+
+// ---------------- Пространственный индекс ----------------
+// Равномерная сетка: карта [0, max_x] x [0, max_y] делится на клетки
+// размером cell. Клетка не меньше максимальной дистанции взаимодействия,
+// поэтому пары в радиусе ищутся только в своей и соседних клетках.
+// Сетка следит за перемещениями в NPCWorld, пока существует.
+class SpatialGrid {
+public:
+    SpatialGrid(int max_x, int max_y, int cell = default_cell_size());
+    ~SpatialGrid();
+
+    SpatialGrid(const SpatialGrid&) = delete;
+    SpatialGrid& operator=(const SpatialGrid&) = delete;
+
+    static int default_cell_size();
+
+    void insert(const std::shared_ptr<NPC> &npc);
+    void relocate(uint32_t index, int x, int y);
+    // перечитать координаты всех NPC сетки из мира
+    void relocate_all(const NPCWorld &world);
+    void clear();
+
+    // f(actor, target) вызывается для каждой пары в радиусе взаимодействия,
+    // actor всегда добавлен в сетку раньше target. Возвращает число
+    // проверенных пар. Двигать NPC из f нельзя.
+    template <typename F>
+    size_t for_each_candidate_pair(F &&f) const;
+    // то же, но обходятся только клетки строк [row_begin, row_end).
+    // Каждая пара находится ровно из одной строки, поэтому строки можно
+    // делить между потоками.
+    template <typename F>
+    size_t for_each_candidate_pair_in_rows(int row_begin, int row_end, F &&f) const;
+
+    size_t size() const;
+    int cell_size() const { return cell; }
+    int cells_x() const { return cols; }
+    int cells_y() const { return rows; }
+
+private:
+    // записи по индексу слота в NPCWorld
+    struct Entry {
+        std::shared_ptr<NPC> npc;
+        uint32_t cell;
+        uint32_t pos;
+        uint32_t seq;
+    };
+
+    static constexpr size_t BUCKET_RESERVE = 16;
+
+    // координаты клетки столбцами - под пакетную проверку дистанции
+    struct Bucket {
+        std::vector<uint32_t> ids;
+        std::vector<int> xs;
+        std::vector<int> ys;
+        std::vector<int> ranges;
+    };
+
+    uint32_t cell_of(int x, int y) const;
+    void unlink(uint32_t index);
+    void link(uint32_t index, uint32_t c, int x, int y, int range);
+    void move_entry(uint32_t index, int x, int y);
+
+    template <typename F>
+    void check(const Bucket &own, size_t i, const Bucket &other, size_t from,
+               std::vector<uint8_t> &mask, size_t &examined, F &f) const;
+
+    int cell;
+    int cols;
+    int rows;
+    std::vector<Entry> entries;
+    std::vector<Bucket> buckets;
+    uint32_t count{0};
+    mutable std::shared_mutex mtx;
+};
+
+// own[i] против other[from..]
+template <typename F>
+void SpatialGrid::check(const Bucket &own, size_t i, const Bucket &other, size_t from,
+                        std::vector<uint8_t> &mask, size_t &examined, F &f) const
+{
+    size_t n = other.ids.size() - from;
+    if (n == 0) return;
+    if (mask.size() < n) mask.resize(n);
+
+    range_mask(own.xs[i], own.ys[i], own.ranges[i],
+               other.xs.data() + from, other.ys.data() + from, other.ranges.data() + from,
+               n, mask.data());
+    examined += n;
+
+    const Entry &ea = entries[own.ids[i]];
+    for (size_t k = 0; k < n; ++k) {
+        if (!mask[k]) continue;
+        const Entry &eb = entries[other.ids[from + k]];
+        if (ea.seq < eb.seq) f(ea.npc, eb.npc);
+        else                 f(eb.npc, ea.npc);
+    }
+}
+
+template <typename F>
+size_t SpatialGrid::for_each_candidate_pair(F &&f) const {
+    return for_each_candidate_pair_in_rows(0, rows, f);
+}
+
+template <typename F>
+size_t SpatialGrid::for_each_candidate_pair_in_rows(int row_begin, int row_end, F &&f) const {
+    std::shared_lock<std::shared_mutex> lck(mtx);
+    thread_local std::vector<uint8_t> mask;
+    size_t examined = 0;
+
+    // половина окрестности: каждая пара соседних клеток просматривается один раз
+    static constexpr int DX[] = {1, -1, 0, 1};
+    static constexpr int DY[] = {0, 1, 1, 1};
+
+    for (int cy = std::max(row_begin, 0); cy < std::min(row_end, rows); ++cy) {
+        for (int cx = 0; cx < cols; ++cx) {
+            const Bucket &own = buckets[cx + cy * cols];
+            if (own.ids.empty()) continue;
+
+            for (size_t i = 0; i < own.ids.size(); ++i) {
+                check(own, i, own, i + 1, mask, examined, f);
+
+                for (int k = 0; k < 4; ++k) {
+                    int nx = cx + DX[k];
+                    int ny = cy + DY[k];
+                    if (nx < 0 || nx >= cols || ny >= rows) continue;
+                    check(own, i, buckets[nx + ny * cols], 0, mask, examined, f);
+                }
+            }
+        }
+    }
+    return examined;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <string>
+#include <string_view>
+#include <iosfwd>
+#include <cstddef>
+#include "npc.h"
+#include "rules.h"
+
+// ---------------- Реестр типов ----------------
+// Параметры типов и правила боя во время работы. Горячие поля (шаг,
+// дальность, правило пары) лежат плоскими массивами фиксированного
+// размера и берутся по номеру типа без ветвлений; имена, символы и
+// цвета лежат отдельно. Реестр начинается со встроенных таблиц из
+// rules.h; load() накладывает поверх них файл настроек, где можно
+// поменять встроенные типы и добавить новые с номерами после Druid.
+// Загружать до создания NPC и запуска симуляции: реестр читается без
+// блокировок.
+//
+// Файл - по записи в строке, от '#' до конца строки комментарий:
+//   type <имя> <символ> <цвет ANSI> <шаг> <дальность>
+//   kill <кто> <кого> <шанс из 36>
+//   heal <кто> <кого> <0|1>
+class TypeRegistry {
+public:
+    static constexpr size_t MAX_TYPES = 16;
+    static_assert((MAX_TYPES & (MAX_TYPES - 1)) == 0, "номер типа берётся маской");
+
+    static TypeRegistry& instance();
+
+    // только встроенные типы и правила
+    void reset();
+    // false при ошибке, текст в error; реестр тогда не меняется
+    bool load(const std::string &filename, std::string *error = nullptr);
+    bool load(std::istream &is, std::string *error = nullptr);
+
+    // типы с номерами 1..size()-1, 0 - Unknown
+    size_t size() const { return count; }
+    bool known(NPCType t) const {
+        return static_cast<size_t>(t) < count && t != NPCType::Unknown;
+    }
+    // Unknown, если такого имени нет
+    NPCType find(std::string_view name) const;
+
+    const TypeRule& type(NPCType t) const { return types[index(t)]; }
+    const PairRule& rule(NPCType actor, NPCType target) const {
+        return rules[index(actor) * MAX_TYPES + index(target)];
+    }
+    const std::string& name(NPCType t) const { return names[index(t)]; }
+    const std::string& color(NPCType t) const { return colors[index(t)]; }
+    char symbol(NPCType t) const { return symbols[index(t)]; }
+
+private:
+    TypeRegistry();
+    static size_t index(NPCType t) { return static_cast<size_t>(t) & (MAX_TYPES - 1); }
+
+    size_t count{0};
+    std::array<TypeRule, MAX_TYPES> types{};
+    std::array<PairRule, MAX_TYPES * MAX_TYPES> rules{};
+    std::array<std::string, MAX_TYPES> names;
+    std::array<std::string, MAX_TYPES> colors;
+    std::array<char, MAX_TYPES> symbols{};
+};
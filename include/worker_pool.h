@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+// ---------------- Пул рабочих потоков ----------------
+// Параллельный цикл по диапазону индексов с кражей работы: у каждого
+// потока своя очередь диапазонов, владелец делит диапазон пополам и
+// берёт младшую половину с конца очереди, свободный поток крадёт самую
+// крупную половину с начала чужой. Вызывающий поток работает наравне
+// с остальными, пока цикл не закончится, поэтому пул из N потоков
+// держит N-1 своих.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return threads.size() + 1; }
+
+    // fn(begin, end) для кусков [0, n) размером не больше grain.
+    // Вызов из fn того же или другого пула выполняется последовательно.
+    void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    // сколько диапазонов было украдено за всё время
+    size_t steals() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    struct alignas(64) Queue {
+        std::mutex mtx;
+        std::deque<Range> items;
+    };
+
+    void worker_loop(size_t self);
+    void work(size_t self);
+    void push(size_t self, Range r);
+    bool pop(size_t self, Range &r);
+    bool steal(size_t self, Range &r);
+
+    std::vector<std::thread> threads;
+    std::unique_ptr<Queue[]> queues;    // 0 - вызывающий поток
+
+    std::mutex call_mtx;                // один цикл за раз
+    std::mutex mtx;
+    std::condition_variable start_cv;
+    size_t generation{0};
+    bool stopping{false};
+
+    const std::function<void(size_t, size_t)>* job{nullptr};
+    size_t job_grain{1};
+    std::atomic<size_t> pending{0};     // индексов ещё не обработано
+    std::atomic<size_t> stolen{0};
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "npc.h"
+#include "type_registry.h"
+
+// ---------------- Кадры мира ----------------
+// Раз в тик симуляция копирует состояние всех NPC в неизменяемый кадр
+// и публикует его. Читатели (draw_map, print_survivors, save_snapshot,
+// подсчёты) держат shared_ptr на кадр сколько угодно: симуляция их не
+// ждёт, а они не видят наполовину сдвинутый тик. Состав мира (слоты,
+// типы, имена) меняется редко и делится между кадрами, пока никто не
+// родился и не исчез.
+struct WorldRoster {
+    uint64_t version{0};                // NPCWorld::membership() при сборке
+    std::vector<uint32_t> slots;
+    std::vector<NPCType> types;
+    std::vector<uint32_t> name_offsets; // count + 1
+    std::string names;
+
+    size_t size() const { return slots.size(); }
+    std::string_view name(size_t k) const {
+        return std::string_view(names).substr(name_offsets[k], name_offsets[k + 1] - name_offsets[k]);
+    }
+};
+
+struct WorldFrame {
+    uint64_t tick{0};
+    std::shared_ptr<const WorldRoster> roster;
+    std::vector<NPCState> states;       // в порядке roster->slots
+
+    size_t size() const { return states.size(); }
+    size_t alive() const;
+    // индекс - NPCType
+    std::array<size_t, TypeRegistry::MAX_TYPES> alive_by_type() const;
+};
+
+// Один писатель, сколько угодно читателей. Буфер кадра переиспользуется,
+// когда его больше никто не держит, так что при одном читателе живут
+// три кадра: текущий, читаемый и заполняемый.
+class FramePublisher {
+public:
+    void publish(const NPCWorld &world, uint64_t tick);
+    // nullptr до первого publish
+    std::shared_ptr<const WorldFrame> latest() const;
+    size_t buffers() const { return pool.size(); }
+
+private:
+    std::shared_ptr<WorldFrame> acquire();
+
+    mutable std::mutex mtx;             // только на обмен указателя
+    std::shared_ptr<const WorldFrame> current;
+    std::vector<std::shared_ptr<WorldFrame>> pool;
+    std::shared_ptr<const WorldRoster> roster;
+};
@@ -1,16 +1,38 @@
 #include "include/npc.h"
 #include "include/game_utils.h"
+#include "include/engine.h"
+#include "include/metrics.h"
 
-#include <thread>
-#include <atomic>
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <random>
 
 using namespace std::chrono_literals;
 
 
-int main() {
+int main(int argc, char** argv) {
+    // тот же сид - та же партия
+    uint64_t game_seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::random_device{}();
+    set_seed(game_seed);
+    std::cout << "seed " << game_seed << "\n";
+
+    // типы и правила: встроенные или из файла, см. type_registry.h
+    if (argc > 2) {
+        std::string error;
+        if (!TypeRegistry::instance().load(argv[2], &error)) {
+            std::cerr << argv[2] << ": " << error << "\n";
+            return 1;
+        }
+    }
+
     auto consoleObs = ConsoleObserver::get();
-    auto fileObs = FileObserver::get("log.txt");
+    // текстовая таблица: log_decode log.bin > log.txt
+    auto fileObs = BinaryFileObserver::get("log.bin");
+    // один раз на всю игру; исходы приходят пачкой за тик
+    EventBus::instance().subscribe(fileObs);
+    // только убийства в консоль:
+    // EventBus::instance().subscribe(consoleObs, {.outcomes = EventFilter::bit(InteractionOutcome::TargetKilled)});
 
     // ---- NPCs ----
     std::vector<std::shared_ptr<NPC>> npcs;
@@ -18,73 +40,45 @@ int main() {
 
     for (int i = 0; i < NPC_COUNT; ++i) {
         NPCType t = random_type();
-        std::string name;
-        if (t == NPCType::Orc)           name = "Orc_" + std::to_string(i+1);
-        else if (t == NPCType::Bear)     name = "Bear_" + std::to_string(i+1);
-        else if (t == NPCType::Squirrel) name = "Squirrel_" + std::to_string(i+1);
-        else                             name = "Druid_" + std::to_string(i+1);
 
+        // имя <тип>_<номер> соберётся только при печати
         auto npc = createNPC(
             t,
-            name,
+            static_cast<uint32_t>(i + 1),
             random_coord(0, MAP_X),
             random_coord(0, MAP_Y)
         );
 
-        // npc->subscribe(consoleObs);
-        npc->subscribe(fileObs);
         npcs.push_back(npc);
     }
 
     print_all(npcs);
 
-    std::atomic<bool> running{true};
-
-    // ---- Interaction thread ----
-    std::thread Interaction_thread(std::ref(InteractionManager::instance()));
-
-    // ---- Move + detect ----
-    std::thread move_thread([&]() {
-        while (running) {
-            for (auto& npc : npcs) {
-                if (!npc->is_alive()) continue;
-
-                int d = npc->get_move_distance();
-                npc->move(
-                    std::rand() % (2 * d + 1) - d,
-                    std::rand() % (2 * d + 1) - d,
-                    MAP_X,
-                    MAP_Y
-                );
-            }
+    // ---- Engine: 100 тиков/с, карта раз в секунду ----
+    EngineConfig cfg;
+    cfg.tick_rate = 100;
+    Engine engine(cfg);
+    for (auto& npc : npcs)
+        engine.add(npc);
 
-            for (size_t i = 0; i < npcs.size(); ++i)
-                for (size_t j = i + 1; j < npcs.size(); ++j)
-                    InteractionManager::instance().push({npcs[i], npcs[j]});
-
-            std::this_thread::sleep_for(10ms);
-        }
-    });
-
-    // ---- Map thread (1 sec) ----
-    std::thread print_thread([&]() {
-        while (running) {
-            draw_map(npcs);
-            std::this_thread::sleep_for(1s);
-        }
-    });
+    // карта перерисовывается на месте, только изменившиеся клетки
+    MapRenderer screen(GRID, GRID, MAP_X, MAP_Y, RenderMode::Diff);
+    engine.on_tick([&](uint64_t) { draw_map(*engine.view(), screen); },
+                   static_cast<uint64_t>(cfg.tick_rate));
 
     // ---- Game duration ----
-    std::this_thread::sleep_for(30s);
-    running = false;
-
-    // ---- Finish ----
-    move_thread.join();
-    print_thread.join();
-
-    InteractionManager::instance().stop();
-    Interaction_thread.join();
-
-    print_survivors(npcs);
+    // раз в секунду: события, убийства/лечения в секунду, задержки фаз
+    MetricsReporter metrics("metrics.log");
+    engine.run_for(30s);
+    metrics.stop();
+
+    auto st = engine.stats();
+    std::cout << "\nticks " << st.ticks << " (" << st.ticks_per_s << "/s), skipped " << st.skipped << "\n";
+    for (size_t p = 0; p < PHASE_COUNT; ++p)
+        std::cout << "  " << phase_name(static_cast<Phase>(p)) << ": "
+                  << st.phase_ms[p] / std::max<uint64_t>(st.ticks, 1) << " ms/tick\n";
+
+    if (auto frame = engine.view()) print_survivors(*frame);
+    else                            print_survivors(npcs);
     return 0;
 }
@@ -0,0 +1,81 @@
+#include "../include/alloc_stats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef ALLOC_STATS
+
+namespace {
+std::atomic<uint64_t> allocs{0};
+std::atomic<uint64_t> frees{0};
+std::atomic<uint64_t> total_bytes{0};
+
+void* counted(size_t n, size_t align) {
+    if (n == 0) n = 1;
+    for (;;) {
+        void *p = align > alignof(std::max_align_t)
+                      ? std::aligned_alloc(align, (n + align - 1) / align * align)
+                      : std::malloc(n);
+        if (p) {
+            allocs.fetch_add(1, std::memory_order_relaxed);
+            total_bytes.fetch_add(n, std::memory_order_relaxed);
+            return p;
+        }
+        std::new_handler h = std::get_new_handler();
+        if (!h) throw std::bad_alloc();
+        h();
+    }
+}
+
+void release(void *p) noexcept {
+    if (!p) return;
+    frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+} // namespace
+
+void* operator new(size_t n) { return counted(n, 0); }
+void* operator new[](size_t n) { return counted(n, 0); }
+void* operator new(size_t n, std::align_val_t a) { return counted(n, static_cast<size_t>(a)); }
+void* operator new[](size_t n, std::align_val_t a) { return counted(n, static_cast<size_t>(a)); }
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+    try { return counted(n, 0); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t n, const std::nothrow_t&) noexcept {
+    try { return counted(n, 0); } catch (...) { return nullptr; }
+}
+
+void* operator new(size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    try { return counted(n, static_cast<size_t>(a)); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    try { return counted(n, static_cast<size_t>(a)); } catch (...) { return nullptr; }
+}
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void *p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+
+bool alloc_stats_enabled() { return true; }
+
+AllocStats alloc_stats() {
+    return {allocs.load(std::memory_order_relaxed), frees.load(std::memory_order_relaxed),
+            total_bytes.load(std::memory_order_relaxed)};
+}
+
+#else
+
+bool alloc_stats_enabled() { return false; }
+AllocStats alloc_stats() { return {}; }
+
+#endif
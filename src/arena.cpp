@@ -0,0 +1,41 @@
+#include "../include/arena.h"
+#include <algorithm>
+
+Arena::Arena(size_t block_bytes_)
+    : block_bytes(std::max<size_t>(block_bytes_, 64)) {}
+
+void* Arena::allocate(size_t bytes, size_t align) {
+    while (current < blocks.size()) {
+        Block &b = blocks[current];
+        size_t at = (offset + align - 1) / align * align;
+        if (at + bytes <= b.size) {
+            offset = at + bytes;
+            return b.mem.get() + at;
+        }
+        ++current;
+        offset = 0;
+    }
+
+    size_t size = std::max(block_bytes, bytes);
+    blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    current = blocks.size() - 1;
+    offset = bytes;
+    return blocks.back().mem.get();
+}
+
+void Arena::reset() {
+    current = 0;
+    offset = 0;
+}
+
+size_t Arena::used() const {
+    size_t n = offset;
+    for (size_t i = 0; i < current && i < blocks.size(); ++i) n += blocks[i].size;
+    return n;
+}
+
+size_t Arena::capacity() const {
+    size_t n = 0;
+    for (auto &b : blocks) n += b.size;
+    return n;
+}
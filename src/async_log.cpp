@@ -0,0 +1,174 @@
+#include "../include/async_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static std::atomic<uint64_t> next_log_id{1};
+
+AsyncLog::AsyncLog(const std::string &filename, AsyncLogOptions opts_, bool truncate)
+    : log_id(next_log_id.fetch_add(1)), opts(opts_)
+{
+    int flags = O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0);
+    fd.store(::open(filename.c_str(), flags, 0644), std::memory_order_release);
+    if (fd < 0) return;
+
+    out.reserve(opts.flush_bytes);
+    flusher = std::thread(&AsyncLog::flusher_loop, this);
+}
+
+AsyncLog::~AsyncLog() {
+    close();
+}
+
+AsyncLog::Staging& AsyncLog::local() {
+    struct Slot {
+        uint64_t id;
+        Staging *st;
+    };
+    thread_local std::vector<Slot> cache;
+
+    for (auto &s : cache)
+        if (s.id == log_id) return *s.st;
+
+    auto st = std::make_unique<Staging>(opts.staging_bytes);
+    Staging *raw = st.get();
+    {
+        std::lock_guard<std::mutex> lck(staging_mtx);
+        stagings.push_back(std::move(st));
+    }
+    cache.push_back({log_id, raw});
+    return *raw;
+}
+
+void AsyncLog::wake() {
+    if (wake_pending.exchange(true)) return;
+    std::lock_guard<std::mutex> lck(mtx);
+    wake_cv.notify_one();
+}
+
+bool AsyncLog::write(std::string_view record) {
+    if (!good()) return false;
+    // пара к close(): либо мы увидим closing, либо close() увидит нас
+    writers.fetch_add(1);
+    bool ok = !closing.load() && append(record);
+    writers.fetch_sub(1, std::memory_order_release);
+    return ok;
+}
+
+bool AsyncLog::append(std::string_view record) {
+    if (record.empty()) return true;
+    Staging &st = local();
+    // по частям запись перемешалась бы с записями других потоков
+    if (record.size() > st.cap) return false;
+
+    size_t len = record.size();
+    size_t h = st.head.load(std::memory_order_relaxed);
+
+    // буфер полон - торопим сброс и ждём; при закрытии запись
+    // отбрасывается целиком, в буфере от неё ничего нет
+    while (h + len - st.tail.load(std::memory_order_acquire) > st.cap) {
+        if (closing.load(std::memory_order_relaxed)) return false;
+        wake();
+        std::this_thread::yield();
+    }
+
+    size_t off = h % st.cap;
+    size_t first = std::min(len, st.cap - off);
+    std::memcpy(st.buf.get() + off, record.data(), first);
+    std::memcpy(st.buf.get(), record.data() + first, len - first);
+    st.head.store(h + len, std::memory_order_release);
+
+    if (h + len - st.tail.load(std::memory_order_relaxed) >= opts.flush_bytes)
+        wake();
+    return true;
+}
+
+void AsyncLog::drain_to_file() {
+    out.clear();
+    {
+        std::lock_guard<std::mutex> lck(staging_mtx);
+        for (auto &st : stagings) {
+            size_t h = st->head.load(std::memory_order_acquire);
+            size_t t = st->tail.load(std::memory_order_relaxed);
+            if (h == t) continue;
+
+            size_t off = t % st->cap;
+            size_t len = h - t;
+            size_t first = std::min(len, st->cap - off);
+            out.insert(out.end(), st->buf.get() + off, st->buf.get() + off + first);
+            out.insert(out.end(), st->buf.get(), st->buf.get() + (len - first));
+            st->tail.store(h, std::memory_order_release);
+        }
+    }
+
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = ::write(fd.load(std::memory_order_relaxed), out.data() + done, out.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    written.fetch_add(done, std::memory_order_relaxed);
+
+    if (done && opts.fsync == FsyncPolicy::EveryFlush)
+        ::fsync(fd.load(std::memory_order_relaxed));
+}
+
+void AsyncLog::flusher_loop() {
+    std::unique_lock<std::mutex> lck(mtx);
+    while (!closing) {
+        wake_cv.wait_for(lck, opts.flush_interval, [this] {
+            return closing || wake_pending || flush_requested != flush_done;
+        });
+        if (closing) break;
+
+        uint64_t target = flush_requested;
+        wake_pending = false;
+        lck.unlock();
+        drain_to_file();
+        lck.lock();
+
+        flush_done = target;
+        flushed_cv.notify_all();
+    }
+}
+
+void AsyncLog::flush() {
+    std::unique_lock<std::mutex> lck(mtx);
+    if (closed || closing || !good()) return;
+
+    uint64_t ticket = ++flush_requested;
+    wake_cv.notify_one();
+    flushed_cv.wait(lck, [&] { return flush_done >= ticket || closed; });
+}
+
+void AsyncLog::close() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        if (closed || closing) return;
+        closing = true;
+    }
+    wake_cv.notify_all();
+    if (flusher.joinable()) flusher.join();
+
+    // запись, начатая до closing, должна попасть в последний сброс
+    while (writers.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+
+    if (int f = fd.load(std::memory_order_relaxed); f >= 0) {
+        drain_to_file();
+        if (opts.fsync != FsyncPolicy::Never) ::fsync(f);
+        ::close(f);
+        fd.store(-1, std::memory_order_release);
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        closed = true;
+    }
+    flushed_cv.notify_all();
+}
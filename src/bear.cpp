@@ -1,12 +1,9 @@
 #include "../include/bear.h"
 #include "../include/npc.h"
 
-Bear::Bear(const std::string &nm, int x_, int y_) {
-    type = NPCType::Bear;
-    name = nm;
-    x = x_;
-    y = y_;
-}
+Bear::Bear(const std::string &nm, int x_, int y_)
+    : NPC(NPCType::Bear, nm, x_, y_)
+{}
 
 InteractionOutcome Bear::accept(IInteractionVisitor &visitor) {
     return visitor.visit(*this);
@@ -0,0 +1,170 @@
+#include "../include/checkpoint.h"
+#include "../include/snapshot.h"
+#include "../include/event_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+using namespace checkpoint;
+
+Checkpointer::Checkpointer(std::string path)
+    : base_path(std::move(path)), delta_path(base_path + ".delta") {}
+
+bool Checkpointer::write_base() {
+    auto &world = NPCWorld::instance();
+
+    // всё, что изменится после этой строки, попадёт в следующую дельту
+    world.drain_dirty([](uint32_t) {});
+
+    std::vector<const NPC*> npcs;
+    known.assign(world.slots(), 0);
+    world.for_each([&](uint32_t i) {
+        npcs.push_back(world.owner(i));
+        known[i] = world.generation(i) + 1;
+    });
+
+    auto now = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    tag = std::max(now, tag + 1);
+    seq = 0;
+
+    std::string tmp = base_path + ".tmp";
+    if (!save_snapshot(npcs, tmp, tag)) return false;
+    if (std::rename(tmp.c_str(), base_path.c_str()) != 0) return false;
+
+    FileHeader h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.tag = tag;
+    delta.close();
+    delta.open(delta_path, std::ios::binary | std::ios::trunc);
+    delta.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    delta.flush();
+    return delta.good();
+}
+
+size_t Checkpointer::write_delta() {
+    if (!delta.is_open()) return 0;
+    auto &world = NPCWorld::instance();
+
+    frame.clear();
+    uint32_t count = 0;
+    std::string scratch;
+
+    world.drain_dirty([&](uint32_t i) {
+        NPC *owner = world.owner(i);
+        uint32_t now = owner ? world.generation(i) + 1 : 0;
+        if (i >= known.size()) known.resize(i + 1, 0);
+        uint32_t was = known[i];
+        known[i] = now;
+
+        DeltaRecord r{};
+        r.slot = i;
+        std::string_view name;
+        if (!now) {
+            if (!was) return;
+            r.kind = DeltaKind::Remove;
+        } else {
+            NPCState st = world.state(i);
+            r.kind = now == was ? DeltaKind::Update : DeltaKind::Spawn;
+            r.type = static_cast<uint8_t>(world.type(i));
+            r.alive = st.alive;
+            r.x = st.x;
+            r.y = st.y;
+            if (r.kind == DeltaKind::Spawn) {
+                name = owner->name(scratch).substr(0, 255);
+                r.name_len = static_cast<uint8_t>(name.size());
+            }
+        }
+
+        const char *p = reinterpret_cast<const char*>(&r);
+        frame.insert(frame.end(), p, p + sizeof(r));
+        frame.insert(frame.end(), name.begin(), name.end());
+        ++count;
+    });
+
+    if (count == 0) return 0;
+
+    FrameHeader fh{};
+    fh.seq = ++seq;
+    fh.count = count;
+    fh.bytes = static_cast<uint32_t>(frame.size());
+    fh.fnv = event_log::fnv1a(event_log::FNV_OFFSET, frame.data(), frame.size());
+    delta.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+    delta.write(frame.data(), frame.size());
+    delta.flush();
+    return count;
+}
+
+std::vector<std::shared_ptr<NPC>> load_checkpoint(const std::string &path) {
+    SnapshotInfo info;
+    auto list = load_snapshot(path, &info);
+    if (info.slots.size() != list.size()) return list;
+
+    std::unordered_map<uint32_t, size_t> by_slot;
+    for (size_t k = 0; k < list.size(); ++k) by_slot[info.slots[k]] = k;
+
+    std::ifstream is(path + ".delta", std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+    FileHeader h{};
+    if (data.size() < sizeof(h)) return list;
+    std::memcpy(&h, data.data(), sizeof(h));
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.tag != info.tag) return list;
+
+    auto &world = NPCWorld::instance();
+    size_t off = sizeof(h);
+    while (off + sizeof(FrameHeader) <= data.size()) {
+        FrameHeader fh;
+        std::memcpy(&fh, data.data() + off, sizeof(fh));
+        off += sizeof(fh);
+
+        // оборванный или испорченный кадр - дальше верить нечему
+        if (off + fh.bytes > data.size()) break;
+        if (event_log::fnv1a(event_log::FNV_OFFSET, data.data() + off, fh.bytes) != fh.fnv) break;
+
+        size_t end = off + fh.bytes;
+        while (off + sizeof(DeltaRecord) <= end) {
+            DeltaRecord r;
+            std::memcpy(&r, data.data() + off, sizeof(r));
+            off += sizeof(r);
+
+            auto it = by_slot.find(r.slot);
+            switch (r.kind) {
+            case DeltaKind::Remove:
+                if (it != by_slot.end()) {
+                    list[it->second] = nullptr;
+                    by_slot.erase(it);
+                }
+                break;
+
+            case DeltaKind::Spawn: {
+                std::string name(data.data() + off, std::min<size_t>(r.name_len, end - off));
+                off += name.size();
+                if (it != by_slot.end()) list[it->second] = nullptr;
+
+                auto p = createNPC(static_cast<NPCType>(r.type), name, r.x, r.y);
+                if (!p) {
+                    if (it != by_slot.end()) by_slot.erase(it);
+                    break;
+                }
+                if (!r.alive) p->must_die();
+                by_slot[r.slot] = list.size();
+                list.push_back(std::move(p));
+                break;
+            }
+
+            case DeltaKind::Update:
+                if (it == by_slot.end()) break;
+                world.place(list[it->second]->handle.index, r.x, r.y);
+                world.set_alive(list[it->second]->handle.index, r.alive);
+                break;
+            }
+        }
+        off = end;
+    }
+
+    list.erase(std::remove(list.begin(), list.end(), nullptr), list.end());
+    return list;
+}
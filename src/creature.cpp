@@ -0,0 +1,10 @@
+#include "../include/creature.h"
+#include "../include/npc.h"
+
+Creature::Creature(NPCType t, const std::string &nm, int x_, int y_)
+    : NPC(t, nm, x_, y_)
+{}
+
+InteractionOutcome Creature::accept(IInteractionVisitor &visitor) {
+    return visitor.visit(static_cast<NPC&>(*this));
+}
@@ -0,0 +1,81 @@
+#include "../include/density_map.h"
+#include <algorithm>
+
+DensityMap::DensityMap(int cols_, int rows_, int world_x_, int world_y_)
+    : w(std::max(cols_, 1)), h(std::max(rows_, 1)),
+      kinds(TypeRegistry::instance().size()),
+      scale_x((int64_t(w) << 32) / std::max(world_x_, 1)),
+      scale_y((int64_t(h) << 32) / std::max(world_y_, 1)),
+      counts(std::make_unique<std::atomic<uint32_t>[]>(cells() * kinds * 2))
+{
+    auto &world = NPCWorld::instance();
+    world.for_each([&](uint32_t i) {
+        NPCState st = world.state(i);
+        add(world.type(i), NPCState::pack(st.x, st.y, st.alive));
+    });
+    world.track(this);
+}
+
+DensityMap::~DensityMap() {
+    NPCWorld::instance().untrack(this);
+}
+
+uint32_t DensityMap::total(size_t cell) const {
+    uint32_t n = 0;
+    for (size_t k = 0; k < kinds * 2; ++k)
+        n += counts[cell * kinds * 2 + k].load(std::memory_order_relaxed);
+    return n;
+}
+
+uint32_t DensityMap::alive(size_t cell) const {
+    uint32_t n = 0;
+    for (size_t t = 0; t < kinds; ++t)
+        n += counts[cell * kinds * 2 + t * 2 + 1].load(std::memory_order_relaxed);
+    return n;
+}
+
+void DensityMap::add(NPCType t, uint64_t state) {
+    NPCState st = NPCState::unpack(state);
+    counts[slot(cell_of(st.x, st.y), t, st.alive)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void DensityMap::remove(NPCType t, uint64_t state) {
+    NPCState st = NPCState::unpack(state);
+    counts[slot(cell_of(st.x, st.y), t, st.alive)].fetch_sub(1, std::memory_order_relaxed);
+}
+
+// ---------------- Отрисовка ----------------
+void DensityMap::render(MapRenderer &r, HeatMode mode) const {
+    static constexpr char RAMP[] = ".:-=+*#%@";
+    constexpr size_t STEPS = sizeof(RAMP) - 1;
+
+    uint32_t peak = 1;
+    if (mode == HeatMode::Density)
+        for (size_t c = 0; c < cells(); ++c) peak = std::max(peak, total(c));
+
+    r.clear();
+    for (size_t c = 0; c < cells(); ++c) {
+        uint32_t best = 0, all = 0;
+        NPCType major = NPCType::Unknown;
+        for (size_t t = 0; t < kinds; ++t) {
+            uint32_t live = counts[c * kinds * 2 + t * 2 + 1].load(std::memory_order_relaxed);
+            all += live + counts[c * kinds * 2 + t * 2].load(std::memory_order_relaxed);
+            if (live > best) {
+                best = live;
+                major = static_cast<NPCType>(t);
+            }
+        }
+        if (!all) continue;
+
+        if (mode == HeatMode::Majority) {
+            if (!best) r.set(c, '*');
+            else       r.set(c, TypeRegistry::instance().symbol(major), major);
+            continue;
+        }
+
+        // ступень по доле от самой людной клетки: она '@', почти пустые '.'
+        char ch = RAMP[size_t(all) * (STEPS - 1) / peak];
+        if (best) r.set(c, ch, major);
+        else      r.set(c, ch);
+    }
+}
@@ -0,0 +1,166 @@
+#include "../include/engine.h"
+#include "../include/metrics.h"
+#include <algorithm>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+const char* phase_name(Phase p) {
+    switch (p) {
+        case Phase::Move:    return "move";
+        case Phase::Detect:  return "detect";
+        case Phase::Resolve: return "resolve";
+        case Phase::Observe: return "observe";
+    }
+    return "?";
+}
+
+Engine::Engine(EngineConfig cfg_)
+    : cfg(cfg_), grid(cfg_.max_x, cfg_.max_y)
+{
+    if (cfg.workers > 1) pool = std::make_unique<WorkerPool>(cfg.workers);
+}
+
+void Engine::add(const std::shared_ptr<NPC> &npc) {
+    grid.insert(npc);
+}
+
+void Engine::on_tick(std::function<void(uint64_t)> f, uint64_t every) {
+    hooks.push_back({std::move(f), std::max<uint64_t>(every, 1)});
+}
+
+// ---------------- Фазы ----------------
+void Engine::move_phase() {
+    auto &world = NPCWorld::instance();
+    shift_x.assign(world.slots(), 0);
+    shift_y.assign(world.slots(), 0);
+
+    uint64_t s = seed();
+    auto shifts = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!world.owner(i) || !world.state(i).alive) continue;
+
+            int d = move_distance(world.type(i));
+            RandomStream gen(s, StreamKind::Move, st.ticks, static_cast<uint32_t>(i));
+            shift_x[i] = gen.uniform(-d, d);
+            shift_y[i] = gen.uniform(-d, d);
+        }
+    };
+    if (pool) pool->parallel_for(world.slots(), 1024, shifts);
+    else      shifts(0, world.slots());
+
+    world.move_all(shift_x, shift_y, cfg.max_x, cfg.max_y);
+}
+
+void Engine::detect_phase() {
+    events.clear();
+    if (!pool) {
+        grid.for_each_candidate_pair([this](const auto &a, const auto &b) {
+            events.push_back({a->handle, b->handle});
+        });
+        st.pairs += events.size();
+        return;
+    }
+
+    // по вектору на строку клеток: порядок пар не зависит от числа потоков
+    size_t rows = static_cast<size_t>(grid.cells_y());
+    row_events.resize(rows);
+    pool->parallel_for(rows, 1, [this](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            auto &out = row_events[r];
+            out.clear();
+            grid.for_each_candidate_pair_in_rows(int(r), int(r) + 1, [&out](const auto &a, const auto &b) {
+                out.push_back({a->handle, b->handle});
+            });
+        }
+    });
+    for (auto &out : row_events)
+        events.insert(events.end(), out.begin(), out.end());
+    st.pairs += events.size();
+}
+
+void Engine::resolve_phase() {
+    InteractionManager::instance().resolve_batch(events, cfg.deterministic ? nullptr : pool.get(), st.ticks);
+}
+
+void Engine::observe_phase() {
+    frames.publish(NPCWorld::instance(), st.ticks);
+    EventBus::instance().flush();
+    for (auto &h : hooks)
+        if (st.ticks % h.every == 0) h.f(st.ticks);
+}
+
+static_assert(static_cast<size_t>(Timer::Observe) == PHASE_COUNT - 1, "таймеры фаз идут в порядке Phase");
+
+void Engine::step() {
+    auto timed = [this](Phase p, void (Engine::*phase)()) {
+        auto t0 = Clock::now();
+        (this->*phase)();
+        auto d = Clock::now() - t0;
+        st.phase_ms[static_cast<size_t>(p)] += std::chrono::duration<double, std::milli>(d).count();
+        METRIC_TIME(static_cast<Timer>(p), uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+    };
+
+    METRIC_SCOPE(Timer::Tick);
+    ++st.ticks;
+    timed(Phase::Move, &Engine::move_phase);
+    timed(Phase::Detect, &Engine::detect_phase);
+    timed(Phase::Resolve, &Engine::resolve_phase);
+    timed(Phase::Observe, &Engine::observe_phase);
+}
+
+// ---------------- Планировщик ----------------
+void Engine::run(uint64_t max_ticks, Clock::time_point deadline) {
+    auto start = Clock::now();
+    uint64_t done = 0;
+
+    auto finish = [&] {
+        st.run_ticks += done;
+        st.elapsed_s += std::chrono::duration<double>(Clock::now() - start).count();
+        st.ticks_per_s = st.elapsed_s > 0 ? st.run_ticks / st.elapsed_s : 0;
+        // стоп относится к этому run; следующий начнётся заново
+        stopping = false;
+    };
+
+    if (cfg.tick_rate <= 0) {
+        while (!stopping && done < max_ticks && Clock::now() < deadline) {
+            step();
+            ++done;
+        }
+        finish();
+        return;
+    }
+
+    auto dt = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / cfg.tick_rate));
+    auto next = start;
+
+    while (!stopping && done < max_ticks) {
+        auto now = Clock::now();
+        if (now >= deadline) break;
+        if (now < next) {
+            std::this_thread::sleep_until(std::min(next, deadline));
+            continue;
+        }
+
+        // тики, которые уже должны были пройти, не считая текущего
+        uint64_t behind = static_cast<uint64_t>((now - next) / dt);
+        uint64_t allowed = cfg.catch_up == CatchUp::Skip ? 0 : cfg.max_catch_up;
+        if (behind > allowed) {
+            st.skipped += behind - allowed;
+            next += dt * static_cast<Clock::rep>(behind - allowed);
+        }
+
+        step();
+        ++done;
+        next += dt;
+    }
+    finish();
+}
+
+void Engine::run_ticks(uint64_t n) {
+    run(n, Clock::time_point::max());
+}
+
+void Engine::run_for(std::chrono::nanoseconds duration) {
+    run(UINT64_MAX, Clock::now() + duration);
+}
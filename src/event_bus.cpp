@@ -0,0 +1,105 @@
+#include "../include/event_bus.h"
+#include "../include/metrics.h"
+#include <algorithm>
+
+EventBus& EventBus::instance() {
+    static EventBus inst;
+    return inst;
+}
+
+EventBus::Token EventBus::subscribe(const std::shared_ptr<IInteractionObserver> &obs, EventFilter filter) {
+    if (!obs) return 0;
+    std::lock_guard<std::mutex> lck(subs_mtx);
+    Token token = next_token++;
+    subs.push_back({token, obs, filter});
+    active.store(subs.size(), std::memory_order_relaxed);
+    return token;
+}
+
+void EventBus::unsubscribe(Token token) {
+    std::lock_guard<std::mutex> lck(subs_mtx);
+    subs.erase(std::remove_if(subs.begin(), subs.end(),
+                              [token](const Subscriber &s) { return s.token == token; }),
+               subs.end());
+    active.store(subs.size(), std::memory_order_relaxed);
+}
+
+// ---------------- Буферы потоков ----------------
+EventBus::Buffer& EventBus::local() {
+    thread_local std::shared_ptr<Buffer> mine;
+    if (!mine) {
+        mine = std::make_shared<Buffer>();
+        std::lock_guard<std::mutex> lck(buffers_mtx);
+        buffers.push_back(mine);
+    }
+    return *mine;
+}
+
+void EventBus::publish(const NPC &actor, const NPC &target, InteractionOutcome outcome) {
+    if (!subscribers() || outcome == InteractionOutcome::NoInteraction) return;
+
+    auto [ax, ay] = actor.position();
+    auto [tx, ty] = target.position();
+    Buffer &buf = local();
+    // замок свой у каждого потока; с ним спорит только flush
+    metrics::lock(buf.mtx);
+    std::lock_guard<std::mutex> lck(buf.mtx, std::adopt_lock);
+    buf.events.push_back({actor.handle, target.handle, ax, ay, tx, ty,
+                          actor.type, target.type, outcome});
+}
+
+// Буферы потоков меняются местами с запасными под своим замком, дальше
+// пачка собирается без замков в арене, которая сбрасывается после
+// доставки: после прогрева flush в кучу не ходит.
+size_t EventBus::flush() {
+    std::lock_guard<std::mutex> flck(flush_mtx);
+
+    size_t total = 0;
+    {
+        std::lock_guard<std::mutex> lck(buffers_mtx);
+        // буферы завершившихся потоков, уже сданные прошлым flush
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                     [](const std::shared_ptr<Buffer> &b) {
+                                         return b.use_count() == 1 && b->events.empty();
+                                     }),
+                      buffers.end());
+        taken = buffers;
+    }
+    for (auto &b : taken) {
+        std::lock_guard<std::mutex> blck(b->mtx);
+        std::swap(b->events, b->spare);
+        total += b->spare.size();
+    }
+    if (!total) {
+        taken.clear();
+        return 0;
+    }
+
+    InteractionRecord *batch = payload.allocate_array<InteractionRecord>(total);
+    size_t n = 0;
+    for (auto &b : taken) {
+        std::copy(b->spare.begin(), b->spare.end(), batch + n);
+        n += b->spare.size();
+        b->spare.clear();
+    }
+    taken.clear();
+
+    {
+        std::lock_guard<std::mutex> lck(subs_mtx);
+        targets = subs;
+    }
+    METRIC_SCOPE(Timer::Observers);
+    for (auto &s : targets) {
+        if (s.filter.all()) {
+            s.obs->on_batch({batch, total});
+            continue;
+        }
+        InteractionRecord *mine = payload.allocate_array<InteractionRecord>(total);
+        InteractionRecord *end = std::copy_if(batch, batch + total, mine,
+                                              [&s](const InteractionRecord &e) { return s.filter.accepts(e); });
+        if (end != mine) s.obs->on_batch({mine, size_t(end - mine)});
+    }
+    targets.clear();
+    payload.reset();
+    return total;
+}
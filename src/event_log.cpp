@@ -0,0 +1,349 @@
+#include "../include/event_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace event_log;
+
+uint32_t event_log::fnv1a(uint32_t h, const void *data, size_t n) {
+    auto p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int16_t clamp16(int v) {
+    return static_cast<int16_t>(std::clamp(v, -32768, 32767));
+}
+
+static size_t name_chunks(std::string_view name) {
+    size_t len = std::min(name.size(), MAX_NAME);
+    return std::max<size_t>(1, (len + NAME_CHUNK - 1) / NAME_CHUNK);
+}
+
+// ---------------- Запись ----------------
+EventLogWriter::EventLogWriter(const std::string &filename, size_t buffer_bytes)
+    : start(std::chrono::steady_clock::now())
+{
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+
+    // в буфер должны влезать заголовок и самое длинное событие: два имени
+    // по MAX_NAME, само событие и контрольная запись
+    size_t min_records = 2 * (MAX_NAME / NAME_CHUNK + 1) + 4;
+    buf.resize(std::max(buffer_bytes / RECORD_SIZE, min_records) * RECORD_SIZE);
+    spare.resize(buf.size());
+
+    Header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.record_size = RECORD_SIZE;
+    h.checksum_every = CHECKSUM_EVERY;
+    h.start_unix_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::memcpy(buf.data(), &h, sizeof(h));
+    used = sizeof(h);
+}
+
+EventLogWriter::~EventLogWriter() {
+    close();
+}
+
+void EventLogWriter::write_out(const char *data, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t k = ::write(fd, data + done, n - done);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += static_cast<size_t>(k);
+    }
+    written.fetch_add(done, std::memory_order_relaxed);
+}
+
+void EventLogWriter::spill(std::unique_lock<std::mutex> &lck) {
+    std::unique_lock<std::mutex> wl(write_mtx);
+    std::swap(buf, spare);
+    size_t n = used;
+    used = 0;
+
+    lck.unlock();
+    write_out(spare.data(), n);
+    wl.unlock();
+    lck.lock();
+}
+
+void EventLogWriter::append(const void *rec) {
+    std::memcpy(buf.data() + used, rec, RECORD_SIZE);
+    used += RECORD_SIZE;
+    block_fnv = fnv1a(block_fnv, rec, RECORD_SIZE);
+    ++total;
+    if (++in_block == CHECKSUM_EVERY) append_checksum();
+}
+
+void EventLogWriter::append_checksum() {
+    ChecksumRecord c{};
+    c.kind = RecordKind::Checksum;
+    c.count = in_block;
+    c.fnv = block_fnv;
+    c.total = total;
+    std::memcpy(buf.data() + used, &c, RECORD_SIZE);
+    used += RECORD_SIZE;
+
+    block_fnv = FNV_OFFSET;
+    in_block = 0;
+    ++block_no;
+}
+
+void EventLogWriter::append_name(uint32_t id, std::string_view name) {
+    name = name.substr(0, MAX_NAME);
+    size_t parts = name_chunks(name);
+    for (size_t part = 0; part < parts; ++part) {
+        NameRecord r{};
+        r.kind = RecordKind::Name;
+        r.length = static_cast<uint8_t>(name.size());
+        r.part = static_cast<uint8_t>(part);
+        r.id = id;
+        std::string_view piece = name.substr(std::min(name.size(), part * NAME_CHUNK), NAME_CHUNK);
+        std::memcpy(r.text, piece.data(), piece.size());
+        append(&r);
+    }
+}
+
+static EventRecord event_record(const InteractionRecord &e) {
+    EventRecord ev{};
+    ev.kind = RecordKind::Event;
+    ev.outcome = static_cast<uint8_t>(e.outcome);
+    ev.actor_type = static_cast<uint8_t>(e.actor_type);
+    ev.target_type = static_cast<uint8_t>(e.target_type);
+    ev.actor = e.actor.index;
+    ev.target = e.target.index;
+    ev.ax = clamp16(e.ax);
+    ev.ay = clamp16(e.ay);
+    ev.tx = clamp16(e.tx);
+    ev.ty = clamp16(e.ty);
+    return ev;
+}
+
+void EventLogWriter::write(const NPC &actor, const NPC &target, InteractionOutcome outcome) {
+    if (outcome == InteractionOutcome::NoInteraction) return;
+
+    auto [ax, ay] = actor.position();
+    auto [tx, ty] = target.position();
+    EventRecord ev = event_record({actor.handle, target.handle, ax, ay, tx, ty,
+                                   actor.type, target.type, outcome});
+
+    std::unique_lock<std::mutex> lck(mtx);
+    if (fd < 0) return;
+    ev.time_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    append_event(actor, target, ev, lck);
+}
+
+void EventLogWriter::write(std::span<const InteractionRecord> events) {
+    auto &world = NPCWorld::instance();
+    uint32_t time_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    std::unique_lock<std::mutex> lck(mtx);
+    for (auto &e : events) {
+        if (fd < 0) return;
+        if (e.outcome == InteractionOutcome::NoInteraction) continue;
+        const NPC *actor = world.get(e.actor);
+        const NPC *target = world.get(e.target);
+        if (!actor || !target) continue;
+
+        EventRecord ev = event_record(e);
+        ev.time_us = time_us;
+        append_event(*actor, *target, ev, lck);
+    }
+}
+
+// имена, которых ещё не было в этом блоке, и само событие; mtx захвачен
+void EventLogWriter::append_event(const NPC &actor, const NPC &target, EventRecord &ev,
+                                  std::unique_lock<std::mutex> &lck)
+{
+    auto needs_name = [this](const NPC &npc) {
+        uint32_t i = npc.handle.index;
+        return i >= named.size() || named[i].generation != npc.handle.generation + 1 ||
+               named[i].block != block_no;
+    };
+
+    const NPC *npcs[2] = {&actor, &target};
+    std::string_view names[2];
+    bool new_block = false;
+
+    // имена и событие ложатся в буфер и в блок одной группой; scratch
+    // общий, а spill отпускает замок - имена берутся заново на каждом круге
+    for (;;) {
+        size_t group = 1;
+        for (int k = 0; k < 2; ++k) {
+            if (!needs_name(*npcs[k])) continue;
+            names[k] = npcs[k]->name(name_scratch[k]);
+            group += name_chunks(names[k]);
+        }
+        // не влезает в блок - закрыть его, в новом нужны оба имени
+        new_block = in_block + group > CHECKSUM_EVERY;
+        if (new_block) {
+            group = 1;
+            for (int k = 0; k < 2; ++k) {
+                names[k] = npcs[k]->name(name_scratch[k]);
+                group += name_chunks(names[k]);
+            }
+        }
+
+        size_t need = group + 1 + new_block;
+        if (used + need * RECORD_SIZE <= buf.size()) break;
+        spill(lck);
+        if (fd < 0) return;
+    }
+
+    if (new_block) append_checksum();
+    for (int k = 0; k < 2; ++k) {
+        const NPC *npc = npcs[k];
+        if (!needs_name(*npc)) continue;
+        if (npc->handle.index >= named.size()) named.resize(npc->handle.index + 1, Named{0, 0});
+        named[npc->handle.index] = {npc->handle.generation + 1, block_no};
+        append_name(npc->handle.index, names[k]);
+    }
+    append(&ev);
+}
+
+void EventLogWriter::flush() {
+    std::unique_lock<std::mutex> lck(mtx);
+    if (fd < 0 || used == 0) return;
+    spill(lck);
+}
+
+void EventLogWriter::close() {
+    std::unique_lock<std::mutex> lck(mtx);
+    if (fd < 0) return;
+
+    while (used + RECORD_SIZE > buf.size()) {
+        spill(lck);
+        if (fd < 0) return;
+    }
+    if (in_block) append_checksum();
+
+    std::lock_guard<std::mutex> wl(write_mtx);
+    write_out(buf.data(), used);
+    used = 0;
+    ::close(fd);
+    fd = -1;
+}
+
+size_t EventLogWriter::records() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return total;
+}
+
+size_t EventLogWriter::bytes_written() const {
+    return written.load(std::memory_order_relaxed);
+}
+
+// ---------------- Чтение ----------------
+EventLogContents read_event_log(const std::string &filename) {
+    EventLogContents res;
+
+    std::ifstream is(filename, std::ios::binary);
+    if (!is.good()) {
+        res.error = "cannot open " + filename;
+        return res;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+    Header h{};
+    if (data.size() < sizeof(h)) {
+        res.error = "truncated header";
+        return res;
+    }
+    std::memcpy(&h, data.data(), sizeof(h));
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        res.error = "not an event log";
+        return res;
+    }
+    if (h.version != VERSION || h.record_size != RECORD_SIZE) {
+        res.error = "unsupported version " + std::to_string(h.version);
+        return res;
+    }
+
+    std::unordered_map<uint32_t, std::string> names;
+    uint64_t time_base = 0;
+    uint32_t last_time = 0;
+
+    auto name_of = [&names](uint32_t id) {
+        auto it = names.find(id);
+        if (it != names.end()) return it->second;
+        std::string unknown = "#";
+        return unknown += std::to_string(id);
+    };
+
+    auto apply = [&](const char *p) {
+        switch (static_cast<RecordKind>(p[0])) {
+        case RecordKind::Name: {
+            NameRecord r;
+            std::memcpy(&r, p, sizeof(r));
+            std::string &s = names[r.id];
+            if (r.part == 0) s.assign(r.length, '\0');
+            size_t off = size_t(r.part) * NAME_CHUNK;
+            if (off < s.size())
+                std::memcpy(s.data() + off, r.text, std::min(NAME_CHUNK, s.size() - off));
+            break;
+        }
+        case RecordKind::Event: {
+            EventRecord r;
+            std::memcpy(&r, p, sizeof(r));
+            if (r.time_us < last_time) time_base += uint64_t(1) << 32;
+            last_time = r.time_us;
+
+            res.events.push_back({name_of(r.actor), name_of(r.target),
+                                  static_cast<NPCType>(r.actor_type), static_cast<NPCType>(r.target_type),
+                                  r.ax, r.ay, r.tx, r.ty,
+                                  static_cast<InteractionOutcome>(r.outcome),
+                                  time_base + r.time_us});
+            break;
+        }
+        default:
+            break;
+        }
+    };
+
+    std::vector<const char*> block;
+    uint32_t fnv = FNV_OFFSET;
+
+    for (size_t off = sizeof(h); off + RECORD_SIZE <= data.size(); off += RECORD_SIZE) {
+        const char *p = data.data() + off;
+        if (static_cast<RecordKind>(p[0]) != RecordKind::Checksum) {
+            block.push_back(p);
+            fnv = fnv1a(fnv, p, RECORD_SIZE);
+            continue;
+        }
+
+        ChecksumRecord c;
+        std::memcpy(&c, p, sizeof(c));
+        if (c.count == block.size() && c.fnv == fnv) {
+            for (const char *r : block) apply(r);
+            ++res.blocks;
+        } else {
+            ++res.bad_blocks;
+        }
+        block.clear();
+        fnv = FNV_OFFSET;
+    }
+
+    // хвост без контрольной записи - файл не был закрыт
+    size_t before = res.events.size();
+    for (const char *r : block) apply(r);
+    res.unverified = res.events.size() - before;
+
+    res.ok = true;
+    return res;
+}
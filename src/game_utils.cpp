@@ -1,10 +1,12 @@
 #include "../include/game_utils.h"
+#include "../include/metrics.h"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <unordered_set>
 #include <algorithm>
 #include <sstream>
+#include <cstdio>
 
 #include <thread>
 #include <mutex>
@@ -33,34 +35,31 @@ std::shared_ptr<IInteractionObserver> ConsoleObserver::get() {
     return std::shared_ptr<IInteractionObserver>(&instance, [](IInteractionObserver*) {});
 }
 
-void ConsoleObserver::on_interaction(const std::shared_ptr<NPC>& actor,
-                               const std::shared_ptr<NPC>& target,
+void ConsoleObserver::on_interaction(const NPC& actor, const NPC& target,
                                InteractionOutcome outcome)
 {
-    if (!actor || !target) return;
-
     std::lock_guard<std::mutex> lck(print_mutex);
 
     switch (outcome) {
     case InteractionOutcome::TargetKilled:
         std::cout << ">>> "
-                  << actor->name << " (" << type_to_string(actor->type) << ")"
+                  << actor.name() << " (" << type_to_string(actor.type) << ")"
                   << " killed "
-                  << target->name << " (" << type_to_string(target->type) << ")\n";
+                  << target.name() << " (" << type_to_string(target.type) << ")\n";
         break;
 
     case InteractionOutcome::TargetEscaped:
         std::cout << ">>> "
-                  << target->name << " (" << type_to_string(target->type) << ")"
+                  << target.name() << " (" << type_to_string(target.type) << ")"
                   << " escaped from "
-                  << actor->name << " (" << type_to_string(actor->type) << ")\n";
+                  << actor.name() << " (" << type_to_string(actor.type) << ")\n";
         break;
 
     case InteractionOutcome::TargetHealed:
         std::cout << ">>> "
-                << actor->name << " (Druid)"
+                << actor.name() << " (Druid)"
                 << "healed"
-                << target->name << " (" << type_to_string(target->type) << ")\n";
+                << target.name() << " (" << type_to_string(target.type) << ")\n";
         break;
 
     case InteractionOutcome::NoInteraction:
@@ -68,259 +67,475 @@ void ConsoleObserver::on_interaction(const std::shared_ptr<NPC>& actor,
     }
 }
 
-FileObserver::FileObserver(const std::string& filename) : fname(filename)
+FileObserver::FileObserver(const std::string& filename, AsyncLogOptions opts)
+    : fname(filename), log(filename, opts)
 {
-    std::ofstream f(fname, std::ios::trunc);
-    if (!f.good()) return;
-
-    std::lock_guard<std::mutex> lck(print_mutex);
+    if (!log.good()) return;
 
-    f << std::left
-      << std::setw(W1)  << "Actor"
-      << std::setw(W2)  << "Type"
-      << std::setw(WP)  << "Pos"
-      << std::setw(WA)  << "Action"
-      << std::setw(W3)  << "Target"
-      << std::setw(W4)  << "Type"
-      << std::setw(WP2) << "Pos"
-      << "\n";
+    log.write(table_header());
+}
 
-    f << std::string(W1 + W2 + WP + WA + W3 + W4 + WP2, '-') << "\n";
+std::string FileObserver::table_header() {
+    char line[256];
+    int n = std::snprintf(line, sizeof(line), "%-*s%-*s%-*s%-*s%-*s%-*s%-*s\n",
+                          W1, "Actor", W2, "Type", WP, "Pos", WA, "Action",
+                          W3, "Target", W4, "Type", WP2, "Pos");
+    return std::string(line, n) + std::string(W1 + W2 + WP + WA + W3 + W4 + WP2, '-') + "\n";
 }
 
-std::shared_ptr<IInteractionObserver> FileObserver::get(const std::string& filename)
+std::shared_ptr<IInteractionObserver> FileObserver::get(const std::string& filename,
+                                                        AsyncLogOptions opts)
 {
-    static std::shared_ptr<IInteractionObserver> instance =
-        std::shared_ptr<IInteractionObserver>(
-            new FileObserver(filename),
-            [](IInteractionObserver*){}
-        );
+    static FileObserver instance(filename, opts);
+    return std::shared_ptr<IInteractionObserver>(&instance, [](IInteractionObserver*) {});
+}
+
+void FileObserver::flush() {
+    log.flush();
+}
+
+int FileObserver::format_row(char *buf, size_t size, const LogRow &row) {
+    // в таблице первым идёт тот, кто совершил действие
+    bool swap = row.outcome == InteractionOutcome::TargetEscaped;
+    const char* action;
+    switch (row.outcome) {
+    case InteractionOutcome::TargetKilled:  action = "killed";  break;
+    case InteractionOutcome::TargetEscaped: action = "escaped"; break;
+    case InteractionOutcome::TargetHealed:  action = "healed";  break;
+    default:
+        if (size) buf[0] = '\0';
+        return 0;
+    }
+
+    std::string_view fName = swap ? row.target : row.actor;
+    std::string_view sName = swap ? row.actor : row.target;
+    NPCType fType = swap ? row.target_type : row.actor_type;
+    NPCType sType = swap ? row.actor_type : row.target_type;
 
-    return instance;
+    char fPos[32], sPos[32];
+    std::snprintf(fPos, sizeof(fPos), "(%d,%d)", swap ? row.tx : row.ax, swap ? row.ty : row.ay);
+    std::snprintf(sPos, sizeof(sPos), "(%d,%d)", swap ? row.ax : row.tx, swap ? row.ay : row.ty);
+
+    return std::snprintf(buf, size, "%-*.*s%-*s%-*s%-*s%-*.*s%-*s%-*s\n",
+                         W1, static_cast<int>(fName.size()), fName.data(),
+                         W2, type_to_string(fType).c_str(), WP, fPos, WA, action,
+                         W3, static_cast<int>(sName.size()), sName.data(),
+                         W4, type_to_string(sType).c_str(), WP2, sPos);
 }
 
-void FileObserver::on_interaction(const std::shared_ptr<NPC>& actor,
-                            const std::shared_ptr<NPC>& target,
+void FileObserver::on_interaction(const NPC& actor, const NPC& target,
                             InteractionOutcome outcome)
 {
-    if (!actor || !target) return;
+    auto [ax, ay] = actor.position();
+    auto [tx, ty] = target.position();
+    std::string an, tn;
+    LogRow row{actor.name(an), actor.type, ax, ay, target.name(tn), target.type, tx, ty, outcome};
+
+    char line[256];
+    int n = format_row(line, sizeof(line), row);
+    if (n <= 0) return;
+    if (static_cast<size_t>(n) < sizeof(line)) {
+        log.write(std::string_view(line, n));
+        return;
+    }
 
-    std::ofstream f(fname, std::ios::app);
-    if (!f.good()) return;
+    // длинные имена
+    std::string big(n + 1, '\0');
+    format_row(big.data(), big.size(), row);
+    log.write(std::string_view(big.data(), n));
+}
 
-    std::lock_guard<std::mutex> lck(print_mutex);
+void FileObserver::on_batch(std::span<const InteractionRecord> events) {
+    constexpr size_t CHUNK = 16 << 10;
+    auto &world = NPCWorld::instance();
+    // пачки приходят по одной из EventBus::flush, буфер переиспользуется
+    std::string &out = batch_buf;
+    out.clear();
+    out.reserve(CHUNK + 256);
+
+    char line[256];
+    for (auto &e : events) {
+        const NPC *a = world.get(e.actor);
+        const NPC *t = world.get(e.target);
+        if (!a || !t) continue;
+
+        LogRow row{a->name(actor_name), e.actor_type, e.ax, e.ay,
+                   t->name(target_name), e.target_type, e.tx, e.ty, e.outcome};
+        int n = format_row(line, sizeof(line), row);
+        if (n <= 0) continue;
+        if (static_cast<size_t>(n) < sizeof(line)) {
+            out.append(line, n);
+        } else {
+            size_t at = out.size();
+            out.resize(at + n + 1);
+            format_row(out.data() + at, n + 1, row);
+            out.resize(at + n);
+        }
+        if (out.size() >= CHUNK) {
+            log.write(out);
+            out.clear();
+        }
+    }
+    if (!out.empty()) log.write(out);
+}
 
-    std::ostringstream ss;
-    ss << '(' << actor->x << ',' << actor->y << ')';
-    std::string aPos = ss.str();
-    ss.str("");
-    ss << '(' << target->x << ',' << target->y << ')';
-    std::string tPos = ss.str();
+BinaryFileObserver::BinaryFileObserver(const std::string& filename)
+    : log(filename) {}
 
-    switch (outcome) {
-    case InteractionOutcome::TargetKilled:
-        f << std::left
-          << std::setw(W1) << actor->name
-          << std::setw(W2) << type_to_string(actor->type)
-          << std::setw(WP) << aPos
-          << std::setw(WA) << "killed"
-          << std::setw(W3) << target->name
-          << std::setw(W4) << type_to_string(target->type)
-          << std::setw(WP2) << tPos
-          << "\n";
-        break;
+std::shared_ptr<IInteractionObserver> BinaryFileObserver::get(const std::string& filename) {
+    static BinaryFileObserver instance(filename);
+    return std::shared_ptr<IInteractionObserver>(&instance, [](IInteractionObserver*) {});
+}
 
-    case InteractionOutcome::TargetEscaped:
-        f << std::left
-          << std::setw(W1) << target->name
-          << std::setw(W2) << type_to_string(target->type)
-          << std::setw(WP) << tPos
-          << std::setw(WA) << "escaped"
-          << std::setw(W3) << actor->name
-          << std::setw(W4) << type_to_string(actor->type)
-          << std::setw(WP2) << aPos
-          << "\n";
-        break;
+void BinaryFileObserver::flush() {
+    log.flush();
+}
 
-    case InteractionOutcome::TargetHealed:
-        f << std::left
-          << std::setw(W1) << actor->name
-          << std::setw(W2) << type_to_string(actor->type)
-          << std::setw(WP) << aPos
-          << std::setw(WA) << "healed"
-          << std::setw(W3) << target->name
-          << std::setw(W4) << type_to_string(target->type)
-          << std::setw(WP2) << tPos
-          << "\n";
-        break;
+void BinaryFileObserver::on_interaction(const NPC& actor, const NPC& target,
+                                  InteractionOutcome outcome)
+{
+    log.write(actor, target, outcome);
+}
 
-    case InteractionOutcome::NoInteraction:
-        break;
-    }
+void BinaryFileObserver::on_batch(std::span<const InteractionRecord> events) {
+    log.write(events);
 }
 
 // ---------------- Логика боя ----------------
-AttackVisitor::AttackVisitor(const std::shared_ptr<NPC>& actor_)
+// Оболочки над TypeRegistry для кода, который идёт через NPC::accept
+AttackVisitor::AttackVisitor(const NPC& actor_)
     : actor(actor_) {}
 
-InteractionOutcome AttackVisitor::visit([[maybe_unused]] Orc& target) {
-    if (!actor->is_alive()) return InteractionOutcome::NoInteraction;
-
-    if (actor->type == NPCType::Orc)
-        return dice() ? InteractionOutcome::TargetKilled : InteractionOutcome::TargetEscaped;
-
-    return InteractionOutcome::NoInteraction;
+InteractionOutcome AttackVisitor::attack(const NPC& target) const {
+    if (!actor.is_alive()) return InteractionOutcome::NoInteraction;
+    return attack_outcome(TypeRegistry::instance().rule(actor.type, target.type));
 }
 
-InteractionOutcome AttackVisitor::visit([[maybe_unused]] Bear& target) {
-    if (!actor->is_alive()) return InteractionOutcome::NoInteraction;
+InteractionOutcome AttackVisitor::visit(Orc& target) { return attack(target); }
+InteractionOutcome AttackVisitor::visit(Bear& target) { return attack(target); }
+InteractionOutcome AttackVisitor::visit(Squirrel& target) { return attack(target); }
+InteractionOutcome AttackVisitor::visit(Druid& target) { return attack(target); }
+InteractionOutcome AttackVisitor::visit(NPC& target) { return attack(target); }
 
-    if (actor->type == NPCType::Orc)
-        return dice() ? InteractionOutcome::TargetKilled : InteractionOutcome::TargetEscaped;
+SupportVisitor::SupportVisitor(const NPC& actor_)
+    : actor(actor_) {}
 
-    return InteractionOutcome::NoInteraction;
+InteractionOutcome SupportVisitor::support(const NPC& target) const {
+    return support_outcome(TypeRegistry::instance().rule(actor.type, target.type), target.is_alive());
 }
 
-InteractionOutcome AttackVisitor::visit([[maybe_unused]] Squirrel& target) {
-    if (!actor->is_alive()) return InteractionOutcome::NoInteraction;
+InteractionOutcome SupportVisitor::visit(Orc& target) { return support(target); }
+InteractionOutcome SupportVisitor::visit(Bear& target) { return support(target); }
+InteractionOutcome SupportVisitor::visit(Squirrel& target) { return support(target); }
+InteractionOutcome SupportVisitor::visit(Druid& target) { return support(target); }
+InteractionOutcome SupportVisitor::visit(NPC& target) { return support(target); }
 
-    if (actor->type == NPCType::Bear)
-        return dice() ? InteractionOutcome::TargetKilled : InteractionOutcome::TargetEscaped;
+InteractionManager::InteractionManager() {
+    configure(DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+}
 
-    return InteractionOutcome::NoInteraction;
+InteractionManager& InteractionManager::instance() {
+    static InteractionManager inst;
+    return inst;
 }
 
-InteractionOutcome AttackVisitor::visit([[maybe_unused]] Druid& target) {
-    if (!actor->is_alive()) return InteractionOutcome::NoInteraction;
+void InteractionManager::configure(size_t capacity, OverflowPolicy policy_) {
+    queue = std::make_unique<MPSCQueue<InteractionEvent>>(capacity);
+    policy = policy_;
 
-    if (actor->type == NPCType::Orc)
-        return dice() ? InteractionOutcome::TargetKilled : InteractionOutcome::TargetEscaped;
+    // открытая адресация по 64-битному ключу пары, с запасом по месту
+    pending_mask = 4 * queue->capacity() - 1;
+    pending = std::make_unique<std::atomic<uint64_t>[]>(pending_mask + 1);
 
-    return InteractionOutcome::NoInteraction;
+    pushed = 0;
+    dropped = 0;
+    coalesced = 0;
+    high_water = 0;
 }
 
-bool AttackVisitor::dice() {
-    return roll() > roll();
+QueueStats InteractionManager::stats() const {
+    return {queue->size(), queue->capacity(), pushed.load(), dropped.load(),
+            coalesced.load(), high_water.load()};
 }
 
-SupportVisitor::SupportVisitor(const std::shared_ptr<NPC>& actor_)
-    : actor(actor_) {}
-
-InteractionOutcome SupportVisitor::visit(Orc&) {
-    return InteractionOutcome::NoInteraction;
+uint64_t InteractionManager::pair_key(const InteractionEvent& ev) {
+    uint64_t a = uint64_t(ev.actor.generation) << 32 | ev.actor.index;
+    uint64_t t = uint64_t(ev.target.generation) << 32 | ev.target.index;
+    uint64_t h = a * 0x9E3779B97F4A7C15ull ^ t;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return h | 1; // 0 означает пустую ячейку
 }
 
-InteractionOutcome SupportVisitor::visit(Bear& target) {
-    if (actor->type == NPCType::Druid && !target.is_alive())
-        return InteractionOutcome::TargetHealed;
+// false, если такая пара уже ждёт в очереди. Проверка и захват ячейки -
+// один CAS: из двух производителей одной пары ячейку займёт один, второй
+// увидит в ней свой ключ. Слияние всё же best-effort: если потребитель
+// освобождает ячейки окна, пока производители его просматривают, двое
+// могут занять разные ячейки и пара встанет в очередь дважды; второе
+// событие разбирается как обычная встреча пары.
+// Если рядом нет свободной ячейки, пара не отслеживается и ставится в
+// очередь как есть.
+bool InteractionManager::mark_pending(uint64_t key) {
+    constexpr size_t PROBES = 8;
+    // ключ мог остаться дальше ячейки, которую уже освободили
+    for (size_t i = 0; i < PROBES; ++i)
+        if (pending[(key + i) & pending_mask].load(std::memory_order_relaxed) == key)
+            return false;
+
+    for (size_t i = 0; i < PROBES; ++i) {
+        uint64_t seen = 0;
+        if (pending[(key + i) & pending_mask].compare_exchange_strong(seen, key))
+            return true;
+        if (seen == key)
+            return false;
+    }
+    return true;
+}
 
-    return InteractionOutcome::NoInteraction;
+void InteractionManager::clear_pending(uint64_t key) {
+    constexpr size_t PROBES = 8;
+    for (size_t i = 0; i < PROBES; ++i) {
+        uint64_t k = key;
+        if (pending[(key + i) & pending_mask].compare_exchange_strong(k, 0))
+            return;
+    }
 }
 
-InteractionOutcome SupportVisitor::visit(Squirrel& target) {
-    if (actor->type == NPCType::Druid && !target.is_alive())
-        return InteractionOutcome::TargetHealed;
+bool InteractionManager::push(InteractionEvent ev) {
+    if (policy == OverflowPolicy::CoalescePair) {
+        uint64_t key = pair_key(ev);
+        if (!mark_pending(key)) {
+            ++coalesced;
+            return false;
+        }
+        if (!queue->try_push(std::move(ev))) {
+            clear_pending(key);
+            ++dropped;
+            return false;
+        }
+    } else {
+        while (!queue->try_push(std::move(ev))) {
+            if (policy == OverflowPolicy::DropOldest) {
+                InteractionEvent old;
+                if (pop(old)) ++dropped;
+            } else if (running) {
+                wait_for_space();
+            } else {
+                ++dropped;
+                return false;
+            }
+        }
+    }
 
-    return InteractionOutcome::NoInteraction;
+    ++pushed;
+    size_t depth = queue->size();
+    METRIC_QUEUE_DEPTH(depth);
+    size_t hw = high_water.load(std::memory_order_relaxed);
+    while (depth > hw && !high_water.compare_exchange_weak(hw, depth)) {}
+
+    // пара к барьеру в wait_for_work: либо потребитель увидит событие,
+    // либо мы увидим, что он уснул
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_parked.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lck(wait_mtx);
+        work_cv.notify_one();
+    }
+    return true;
 }
 
-InteractionOutcome SupportVisitor::visit(Druid&) {
-    return InteractionOutcome::NoInteraction;
+void InteractionManager::wait_for_work() {
+    std::unique_lock<std::mutex> lck(wait_mtx);
+    consumer_parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    work_cv.wait(lck, [this] { return !running || queue->size() > 0; });
+    consumer_parked.store(false, std::memory_order_relaxed);
 }
 
-InteractionManager& InteractionManager::instance() {
-    static InteractionManager inst;
-    return inst;
+void InteractionManager::wait_for_space() {
+    std::unique_lock<std::mutex> lck(wait_mtx);
+    ++producers_blocked;
+    // пара к барьеру в drain: либо мы увидим место, либо потребитель
+    // увидит ждущего производителя и разбудит его
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    space_cv.wait(lck, [this] {
+        return !running || queue->size() < queue->capacity();
+    });
+    --producers_blocked;
 }
 
-void InteractionManager::push(InteractionEvent ev) {
-    std::lock_guard<std::mutex> lock(mtx);
-    queue.push(std::move(ev));
+bool InteractionManager::pop(InteractionEvent& ev) {
+    if (!queue->try_pop(ev)) return false;
+    if (policy == OverflowPolicy::CoalescePair)
+        clear_pending(pair_key(ev));
+    return true;
 }
 
-void InteractionManager::apply_outcome(const std::shared_ptr<NPC>& actor,
-                   const std::shared_ptr<NPC>& target,
+void InteractionManager::apply_outcome(NPC& actor, NPC& target,
                    InteractionOutcome outcome)
 {
     switch (outcome) {
     case InteractionOutcome::TargetKilled:
-        target->must_die();
-        actor->notify_interaction(target, outcome);
+        target.must_die();
+        METRIC_COUNT(Counter::Kills, 1);
         break;
 
     case InteractionOutcome::TargetEscaped:
-        actor->notify_interaction(target, outcome);
+        METRIC_COUNT(Counter::Escapes, 1);
         break;
 
     case InteractionOutcome::TargetHealed:
-        target->heal();
-        actor->notify_interaction(target, outcome);
+        target.heal();
+        METRIC_COUNT(Counter::Heals, 1);
         break;
 
     case InteractionOutcome::NoInteraction:
-        break;
+        return;
     }
+
+    EventBus::instance().publish(actor, target, outcome);
+    actor.notify_interaction(target, outcome);
 }
 
-void InteractionManager::operator()() {
-    using namespace std::chrono_literals;
+// Те же шаги, что у посетителей через accept, но правило берётся из
+// реестра по типам из NPCWorld: ни одного виртуального вызова, к
+// объекту NPC обращаемся только за наблюдателями.
+void InteractionManager::resolve(const InteractionEvent& ev, RandomStream& dice) {
+    auto &world = NPCWorld::instance();
+    auto &types = TypeRegistry::instance();
+    NPC *pa = world.get(ev.actor);
+    NPC *pt = world.get(ev.target);
+    if (!pa || !pt) return;
+
+    uint32_t ia = ev.actor.index, it = ev.target.index;
+    NPCType ta = world.type(ia), tt = world.type(it);
+    NPCState sa = world.state(ia), st = world.state(it);
+
+    long long dx = sa.x - st.x, dy = sa.y - st.y;
+    long long reach = types.type(ta).reach;
+    if (dx * dx + dy * dy > reach * reach) return;
+
+    const PairRule &forth = types.rule(ta, tt);
+    const PairRule &back = types.rule(tt, ta);
+
+    if (sa.alive && st.alive) {
+        apply_outcome(*pa, *pt, attack_outcome(forth, dice));
+        if (world.state(it).alive)
+            apply_outcome(*pt, *pa, attack_outcome(back, dice));
+    }
 
-    while (running) {
-        std::optional<InteractionEvent> ev;
+    bool a_alive = world.state(ia).alive, t_alive = world.state(it).alive;
+    if (a_alive || t_alive) {
+        apply_outcome(*pa, *pt, support_outcome(forth, t_alive));
+        apply_outcome(*pt, *pa, support_outcome(back, world.state(ia).alive));
+    }
+}
 
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            if (!queue.empty()) {
-                ev = queue.front();
-                queue.pop();
-            }
-        }
+// Замки слотов NPCWorld по возрастанию номера полосы: они же не дают
+// ~NPC освободить пару, пока разбор не закончен.
+void InteractionManager::resolve_locked(const InteractionEvent& ev, RandomStream& dice) {
+    auto &world = NPCWorld::instance();
+    size_t s1 = ev.actor.index % NPCWorld::GUARD_STRIPES;
+    size_t s2 = ev.target.index % NPCWorld::GUARD_STRIPES;
+    if (s1 > s2) std::swap(s1, s2);
+
+    std::mutex &m1 = world.guard(static_cast<uint32_t>(s1));
+    metrics::lock(m1);
+    std::lock_guard<std::mutex> first(m1, std::adopt_lock);
+    std::unique_lock<std::mutex> second;
+    if (s2 != s1) {
+        std::mutex &m2 = world.guard(static_cast<uint32_t>(s2));
+        metrics::lock(m2);
+        second = std::unique_lock<std::mutex>(m2, std::adopt_lock);
+    }
 
-        if (ev) {
-            auto a = ev->actor;
-            auto t = ev->target;
+    resolve(ev, dice);
+}
 
-            if (!a || !t) {
-                std::this_thread::sleep_for(100ms);
-                continue;
-            }
+void InteractionManager::set_workers(size_t workers) {
+    pool = workers > 1 ? std::make_unique<WorkerPool>(workers) : nullptr;
+}
 
-            if (a->is_alive() && t->is_alive() &&
-                a->is_close(t, a->get_interaction_distance()))
-            {
-                AttackVisitor av1(a);
-                apply_outcome(a, t, t->accept(av1));
-                AttackVisitor av2(t);
-                apply_outcome(t, a, a->accept(av2));
-            }
+void InteractionManager::set_deterministic(bool on) {
+    deterministic = on;
+}
 
-            if ((a->is_alive() || t->is_alive()) &&
-                a->is_close(t, a->get_interaction_distance())) {
-                SupportVisitor sv1(a);
-                apply_outcome(a, t, t->accept(sv1));
+size_t InteractionManager::drain(size_t max_events) {
+    batch.clear();
+    InteractionEvent ev;
+    while (batch.size() < max_events && pop(ev))
+        batch.push_back(std::move(ev));
+    METRIC_QUEUE_DEPTH(queue->size());
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!batch.empty() && producers_blocked.load() > 0) {
+        std::lock_guard<std::mutex> lck(wait_mtx);
+        space_cv.notify_all();
+    }
 
-                SupportVisitor sv2(t);
-                apply_outcome(t, a, a->accept(sv2));
-            }
+    {
+        METRIC_SCOPE(Timer::Drain);
+        resolve_batch(batch, deterministic ? nullptr : pool.get(), drained++);
+        EventBus::instance().flush();
+    }
 
-            std::this_thread::sleep_for(10ms);
+    size_t n = batch.size();
+    batch.clear();
+    return n;
+}
+
+void InteractionManager::resolve_batch(const std::vector<InteractionEvent>& events, WorkerPool* with,
+                                       uint64_t round)
+{
+    METRIC_COUNT(Counter::Events, events.size());
+    if (with) {
+        with->parallel_for(events.size(), 16, [this, &events, round](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                RandomStream dice(StreamKind::Dice, round, static_cast<uint32_t>(i));
+                resolve_locked(events[i], dice);
+            }
+        });
+    } else {
+        for (size_t i = 0; i < events.size(); ++i) {
+            RandomStream dice(StreamKind::Dice, round, static_cast<uint32_t>(i));
+            resolve_locked(events[i], dice);
         }
-        std::this_thread::sleep_for(10ms);
+    }
+}
+
+void InteractionManager::operator()() {
+    while (running) {
+        if (drain() == 0)
+            wait_for_work();
     }
 }
 
 void InteractionManager::stop() {
-    running = false;
+    {
+        std::lock_guard<std::mutex> lck(wait_mtx);
+        running = false;
+    }
+    work_cv.notify_all();
+    space_cv.notify_all();
 }
 
 // ---------------- Сохранение/Загрузка ----------------
-void save_all(const std::vector<std::shared_ptr<NPC>> &list, const std::string &filename) {
+void save_all(const std::vector<std::shared_ptr<NPC>> &list, const std::string &filename,
+              SaveFormat format)
+{
+    if (format == SaveFormat::Binary) {
+        save_snapshot(list, filename);
+        return;
+    }
+
     std::ofstream os(filename, std::ios::trunc);
     os << list.size() << '\n';
     for (auto &p : list) p->save(os);
 }
 
 std::vector<std::shared_ptr<NPC>> load_all(const std::string &filename) {
+    if (is_snapshot(filename)) return load_snapshot(filename);
+
     std::vector<std::shared_ptr<NPC>> res;
     std::ifstream is(filename);
     if (!is.good()) return res;
@@ -346,11 +561,12 @@ void print_all(const std::vector<std::shared_ptr<NPC>> &list) {
     std::cout << std::string(W1 + W2 + W3 + W4, '-') << "\n";
     for (auto &p : list) {
         if (!p) continue;
+        auto [x, y] = p->position();
         std::cout << std::left
-                  << std::setw(W1) << p->name
+                  << std::setw(W1) << p->name()
                   << std::setw(W2) << type_to_string(p->type)
-                  << std::setw(W3) << p->x
-                  << std::setw(W4) << p->y
+                  << std::setw(W3) << x
+                  << std::setw(W4) << y
                   << "\n";
     }
     std::cout << std::string(40, '=') << std::endl << std::endl;
@@ -366,65 +582,107 @@ void print_survivors(const std::vector<std::shared_ptr<NPC>>& npcs) {
         }
 }
 
-void draw_map(const std::vector<std::shared_ptr<NPC>>& list) {
-    std::array<std::pair<std::string, char>, GRID * GRID> field{};
-    field.fill({"", ' '});
+void print_survivors(const WorldFrame& frame) {
+    std::lock_guard<std::mutex> lck(print_mutex);
+    std::cout << "\n=== Survivors ===\n";
+    for (size_t k = 0; k < frame.size(); ++k) {
+        const NPCState& st = frame.states[k];
+        if (!st.alive) continue;
+        std::cout << frame.roster->name(k) << " [" << type_to_string(frame.roster->types[k])
+                  << "] at (" << st.x << "," << st.y << ")\n";
+    }
+}
+
+// карта GRID x GRID; у каждого потока свой буфер
+static MapRenderer& default_renderer() {
+    thread_local MapRenderer r(GRID, GRID, MAP_X, MAP_Y);
+    r.clear();
+    return r;
+}
 
+static void print_map(MapRenderer& r) {
+    std::lock_guard<std::mutex> lck(print_mutex);
+    std::cout.flush();
+    r.present();
+}
+
+void draw_map(const std::vector<std::shared_ptr<NPC>>& list) {
+    METRIC_SCOPE(Timer::DrawMap);
+    MapRenderer& r = default_renderer();
     for (auto& npc : list) {
         auto [x, y] = npc->position();
+        r.put(npc->type, x, y, npc->is_alive());
+    }
+    print_map(r);
+}
 
-        int gx = std::clamp(x * GRID / MAP_X, 0, GRID - 1);
-        int gy = std::clamp(y * GRID / MAP_Y, 0, GRID - 1);
-
-        char c;
-        if (!npc->is_alive())
-            c = '*';
-        else {
-            switch (npc->type) {
-                case NPCType::Orc: c = 'O'; break;
-                case NPCType::Bear: c = 'B'; break;
-                case NPCType::Squirrel: c = 'S'; break;
-                case NPCType::Druid: c = 'D'; break;
-                default: c = '?';
-            }
+void draw_map(const NPCWorld& world, WorkerPool* pool) {
+    METRIC_SCOPE(Timer::DrawMap);
+    MapRenderer& r = default_renderer();
+
+    if (!pool) {
+        world.for_each([&](uint32_t i) {
+            NPCState st = world.state(i);
+            r.put(world.type(i), st.x, st.y, st.alive);
+        });
+        print_map(r);
+        return;
+    }
+
+    // в клетке остаётся NPC с наибольшим слотом - как при обходе по порядку
+    std::vector<std::atomic<uint32_t>> top(size_t(r.cols()) * r.rows());
+    pool->parallel_for(world.slots(), NPCWorld::CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!world.owner(i)) continue;
+            NPCState st = world.state(i);
+
+            auto& cell = top[r.cell_of(st.x, st.y)];
+            uint32_t slot = static_cast<uint32_t>(i) + 1;
+            uint32_t cur = cell.load(std::memory_order_relaxed);
+            while (cur < slot && !cell.compare_exchange_weak(cur, slot, std::memory_order_relaxed)) {}
         }
+    });
 
-        field[gx + gy * GRID] = {npc->get_color(npc->type), c};
+    for (size_t c = 0; c < top.size(); ++c) {
+        uint32_t slot = top[c].load(std::memory_order_relaxed);
+        if (!slot) continue;
+        NPCState st = world.state(slot - 1);
+        r.put(world.type(slot - 1), st.x, st.y, st.alive);
     }
+    print_map(r);
+}
 
-    std::lock_guard<std::mutex> lck(print_mutex);
+void draw_map(const WorldFrame& frame) {
+    draw_map(frame, default_renderer());
+}
 
-    std::cout << std::string(3 * GRID, '=') << "\n";
-    for (int y = 0; y < GRID; ++y) {
-        for (int x = 0; x < GRID; ++x) {
-            auto [color, ch] = field[x + y * GRID];
-            std::string reset = "\033[0m";
-            std::cout << "[" << color << ch << reset << "]";
-        }
-        std::cout << '\n';
+void draw_map(const WorldFrame& frame, MapRenderer& r) {
+    METRIC_SCOPE(Timer::DrawMap);
+    r.clear();
+    // как в draw_map(world): в клетке остаётся NPC с большим слотом
+    for (size_t k = 0; k < frame.size(); ++k) {
+        const NPCState& st = frame.states[k];
+        r.put(frame.roster->types[k], st.x, st.y, st.alive);
     }
-    std::cout << std::string(3 * GRID, '=') << "\n\n";
+    print_map(r);
 }
 
-// ---------------- Функции рандома (можно заменить на обычный rand) ----------------
-NPCType random_type() {
-    static std::mt19937 gen(std::random_device{}());
-    std::uniform_int_distribution<int> dist(1, 4);
-    return static_cast<NPCType>(dist(gen));
+void draw_heatmap(const DensityMap& map, HeatMode mode) {
+    MapRenderer r(map.cols(), map.rows(), MAP_X, MAP_Y);
+    draw_heatmap(map, r, mode);
 }
 
-int random_coord(int min, int max) {
-    static std::mt19937 gen(std::random_device{}());
-    std::uniform_int_distribution<int> dist(min, max);
-    return dist(gen);
+void draw_heatmap(const DensityMap& map, MapRenderer& r, HeatMode mode) {
+    map.render(r, mode);
+    print_map(r);
 }
 
-std::mt19937& rng() {
-    static std::mt19937 gen{std::random_device{}()};
-    return gen;
+// ---------------- Функции рандома ----------------
+NPCType random_type() {
+    int last = static_cast<int>(TypeRegistry::instance().size()) - 1;
+    return static_cast<NPCType>(rng().uniform(1, last));
 }
 
-int roll() {
-    static std::uniform_int_distribution<int> d(1, 6);
-    return d(rng());
+int random_coord(int min, int max) {
+    return rng().uniform(min, max);
 }
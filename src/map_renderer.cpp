@@ -0,0 +1,133 @@
+#include "../include/map_renderer.h"
+#include "../include/type_registry.h"
+#include <algorithm>
+#include <charconv>
+#include <unistd.h>
+
+static constexpr char RESET[] = "\033[0m";
+
+static char npc_symbol(NPCType t, bool alive) {
+    return alive ? TypeRegistry::instance().symbol(t) : '*';
+}
+
+static constexpr uint16_t EMPTY = ' ';
+
+static uint16_t glyph(char symbol, int color) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(symbol) | (color + 1) << 8);
+}
+
+MapRenderer::MapRenderer(int cols_, int rows_, int world_x_, int world_y_, RenderMode mode_)
+    : w(std::max(cols_, 1)), h(std::max(rows_, 1)),
+      world_x(std::max(world_x_, 1)), world_y(std::max(world_y_, 1)),
+      mode(mode_),
+      cells(size_t(w) * h, EMPTY)
+{
+    // полный кадр: "[" + цвет + символ + "]" на клетку и рамка
+    buf.reserve(size_t(w) * h * 8 + size_t(h) * 8 + size_t(w) * 6 + 64);
+}
+
+size_t MapRenderer::cell_of(int x, int y) const {
+    int gx = std::clamp(static_cast<int>(int64_t(x) * w / world_x), 0, w - 1);
+    int gy = std::clamp(static_cast<int>(int64_t(y) * h / world_y), 0, h - 1);
+    return size_t(gx) + size_t(gy) * w;
+}
+
+void MapRenderer::clear() {
+    std::fill(cells.begin(), cells.end(), EMPTY);
+}
+
+void MapRenderer::put(NPCType t, int x, int y, bool alive) {
+    cells[cell_of(x, y)] = glyph(npc_symbol(t, alive), static_cast<int>(t) % TypeRegistry::MAX_TYPES);
+}
+
+void MapRenderer::set(size_t cell, char symbol, NPCType color) {
+    cells[cell] = glyph(symbol, static_cast<int>(color) % TypeRegistry::MAX_TYPES);
+}
+
+void MapRenderer::set(size_t cell, char symbol) {
+    cells[cell] = glyph(symbol, -1);
+}
+
+void MapRenderer::set_color(uint16_t g) {
+    int want = (g >> 8) - 1;
+    if (want == color) return;
+    if (want < 0) buf += RESET;
+    else          buf += type_color(static_cast<NPCType>(want));
+    color = want;
+}
+
+void MapRenderer::put_glyph(uint16_t g) {
+    set_color(g);
+    buf += '[';
+    buf += static_cast<char>(g & 0xFF);
+    buf += ']';
+}
+
+void MapRenderer::compose_full() {
+    buf.append(size_t(3) * w, '=');
+    buf += '\n';
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x)
+            put_glyph(cells[size_t(x) + size_t(y) * w]);
+        buf += '\n';
+    }
+    set_color(EMPTY);
+    buf.append(size_t(3) * w, '=');
+    buf += "\n\n";
+    emitted = cells.size();
+}
+
+void MapRenderer::compose_diff() {
+    auto move_to = [this](int line, int col) {
+        char num[16];
+        buf += "\033[";
+        buf.append(num, std::to_chars(num, num + sizeof(num), line).ptr);
+        buf += ';';
+        buf.append(num, std::to_chars(num, num + sizeof(num), col).ptr);
+        buf += 'H';
+    };
+
+    emitted = 0;
+    size_t cursor = SIZE_MAX;   // клетка, перед которой стоит курсор
+    for (size_t c = 0; c < cells.size(); ++c) {
+        if (cells[c] == shown[c]) continue;
+        int x = static_cast<int>(c % w), y = static_cast<int>(c / w);
+        if (cursor != c) move_to(y + 2, 3 * x + 1);
+        put_glyph(cells[c]);
+        cursor = x + 1 < w ? c + 1 : SIZE_MAX;
+        ++emitted;
+    }
+    if (emitted) {
+        set_color(EMPTY);
+        move_to(h + 3, 1);
+    }
+}
+
+const std::string& MapRenderer::compose() {
+    buf.clear();
+    color = -1;
+
+    if (mode == RenderMode::Full) {
+        compose_full();
+    } else if (!has_shown) {
+        buf += "\033[H\033[2J";
+        compose_full();
+        has_shown = true;
+    } else {
+        compose_diff();
+    }
+
+    if (mode == RenderMode::Diff) shown = cells;
+    return buf;
+}
+
+bool MapRenderer::present(int fd) {
+    const std::string &out = compose();
+    size_t off = 0;
+    while (off < out.size()) {
+        ssize_t n = ::write(fd, out.data() + off, out.size() - off);
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
@@ -0,0 +1,323 @@
+#include "../include/metrics.h"
+#include <bit>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+const char* timer_name(Timer t) {
+    switch (t) {
+        case Timer::Move:      return "move";
+        case Timer::Detect:    return "detect";
+        case Timer::Resolve:   return "resolve";
+        case Timer::Observe:   return "observe";
+        case Timer::Tick:      return "tick";
+        case Timer::Drain:     return "drain";
+        case Timer::Observers: return "observers";
+        case Timer::DrawMap:   return "draw_map";
+        case Timer::LockWait:  return "lock_wait";
+    }
+    return "?";
+}
+
+const char* counter_name(Counter c) {
+    switch (c) {
+        case Counter::Events:  return "events";
+        case Counter::Kills:   return "kills";
+        case Counter::Escapes: return "escapes";
+        case Counter::Heals:   return "heals";
+    }
+    return "?";
+}
+
+// ---------------- Гистограмма ----------------
+size_t LatencyHistogram::bucket(uint64_t ns) {
+    if (ns < SUB) return static_cast<size_t>(ns);
+    unsigned shift = static_cast<unsigned>(std::bit_width(ns)) - 1 - SUB_BITS;
+    return (shift + 1) * SUB + ((ns >> shift) & (SUB - 1));
+}
+
+uint64_t LatencyHistogram::lower(size_t b) {
+    if (b < SUB) return b;
+    size_t shift = b / SUB - 1;
+    return (SUB + b % SUB) << shift;
+}
+
+uint64_t LatencyHistogram::upper(size_t b) {
+    if (b < SUB) return b;
+    return lower(b) + ((uint64_t(1) << (b / SUB - 1)) - 1);
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    ++counts[bucket(ns)];
+    ++count;
+    total_ns += ns;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (!count) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * double(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        seen += counts[b];
+        if (seen >= rank) return upper(b);
+    }
+    return max();
+}
+
+uint64_t LatencyHistogram::max() const {
+    for (size_t b = BUCKETS; b-- > 0;)
+        if (counts[b]) return upper(b);
+    return 0;
+}
+
+LatencyHistogram& LatencyHistogram::operator-=(const LatencyHistogram &o) {
+    for (size_t b = 0; b < BUCKETS; ++b) counts[b] -= o.counts[b];
+    count -= o.count;
+    total_ns -= o.total_ns;
+    return *this;
+}
+
+MetricsSnapshot MetricsSnapshot::operator-(const MetricsSnapshot &o) const {
+    MetricsSnapshot d = *this;
+    for (size_t t = 0; t < TIMER_COUNT; ++t) d.timers[t] -= o.timers[t];
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) d.counters[c] -= o.counters[c];
+    return d;
+}
+
+// ---------------- Наборы потоков ----------------
+// Писатель у набора один - его поток, поэтому хватает load + store без
+// RMW; snapshot читает relaxed и может увидеть запись наполовину
+// (счётчик уже, гистограмма ещё нет) - для отчёта это неважно.
+// Завершившийся поток переносит свой набор в общий итог, обнуляет его
+// и отдаёт следующему новому потоку.
+namespace {
+using Cell = std::atomic<uint64_t>;
+
+struct ThreadMetrics {
+    std::array<std::array<Cell, LatencyHistogram::BUCKETS>, TIMER_COUNT> buckets{};
+    std::array<Cell, TIMER_COUNT> counts{};
+    std::array<Cell, TIMER_COUNT> totals{};
+    std::array<Cell, COUNTER_COUNT> counters{};
+};
+
+inline void bump(Cell &c, uint64_t n) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct Registry {
+    std::mutex mtx;
+    std::vector<std::unique_ptr<ThreadMetrics>> sets;   // все, и свободные (нулевые)
+    std::vector<ThreadMetrics*> free;
+    // вклад завершившихся потоков, под mtx
+    std::array<LatencyHistogram, TIMER_COUNT> retired_timers;
+    std::array<uint64_t, COUNTER_COUNT> retired_counters{};
+    Cell queue_depth{0};
+    Cell queue_high_water{0};
+};
+
+Registry& registry() {
+    // не разрушается: потоки могут писать метрики при завершении процесса
+    static Registry *r = new Registry;
+    return *r;
+}
+
+ThreadMetrics* acquire() {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lck(r.mtx);
+    if (!r.free.empty()) {
+        ThreadMetrics *m = r.free.back();
+        r.free.pop_back();
+        return m;
+    }
+    r.sets.push_back(std::make_unique<ThreadMetrics>());
+    return r.sets.back().get();
+}
+
+// под mtx: снимок видит вклад либо в наборе, либо в итоге, но не дважды
+void retire(ThreadMetrics *m) {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lck(r.mtx);
+    for (size_t t = 0; t < TIMER_COUNT; ++t) {
+        LatencyHistogram &h = r.retired_timers[t];
+        for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b)
+            h.counts[b] += m->buckets[t][b].exchange(0, std::memory_order_relaxed);
+        h.count += m->counts[t].exchange(0, std::memory_order_relaxed);
+        h.total_ns += m->totals[t].exchange(0, std::memory_order_relaxed);
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; ++c)
+        r.retired_counters[c] += m->counters[c].exchange(0, std::memory_order_relaxed);
+    r.free.push_back(m);
+}
+
+// Указатель и флаг без деструкторов: к ним можно обращаться и из
+// деструкторов других thread_local, когда Release уже отработал.
+thread_local ThreadMetrics *mine = nullptr;
+thread_local bool exited = false;
+
+struct Release {
+    ~Release() {
+        if (mine) retire(mine);
+        mine = nullptr;
+        exited = true;
+    }
+};
+
+// nullptr, если поток уже завершается: такие замеры теряются
+ThreadMetrics* local() {
+    if (mine) return mine;
+    if (exited) return nullptr;
+    thread_local Release release;
+    (void)release;
+    mine = acquire();
+    return mine;
+}
+}
+
+namespace metrics {
+void record(Timer t, uint64_t ns) {
+    ThreadMetrics *m = local();
+    if (!m) return;
+    size_t i = static_cast<size_t>(t);
+    bump(m->buckets[i][LatencyHistogram::bucket(ns)], 1);
+    bump(m->counts[i], 1);
+    bump(m->totals[i], ns);
+}
+
+void count(Counter c, uint64_t n) {
+    if (ThreadMetrics *m = local())
+        bump(m->counters[static_cast<size_t>(c)], n);
+}
+
+void queue_depth(size_t depth) {
+    auto &r = registry();
+    r.queue_depth.store(depth, std::memory_order_relaxed);
+    uint64_t hw = r.queue_high_water.load(std::memory_order_relaxed);
+    while (depth > hw && !r.queue_high_water.compare_exchange_weak(hw, depth, std::memory_order_relaxed)) {}
+}
+}
+
+bool metrics_enabled() {
+#ifdef GAME_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+MetricsSnapshot metrics_snapshot() {
+    MetricsSnapshot s;
+    s.at = Clock::now();
+    auto &r = registry();
+    std::lock_guard<std::mutex> lck(r.mtx);
+    s.timers = r.retired_timers;
+    s.counters = r.retired_counters;
+    for (auto &m : r.sets) {
+        for (size_t t = 0; t < TIMER_COUNT; ++t) {
+            LatencyHistogram &h = s.timers[t];
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b)
+                h.counts[b] += m->buckets[t][b].load(std::memory_order_relaxed);
+            h.count += m->counts[t].load(std::memory_order_relaxed);
+            h.total_ns += m->totals[t].load(std::memory_order_relaxed);
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; ++c)
+            s.counters[c] += m->counters[c].load(std::memory_order_relaxed);
+    }
+    s.queue_depth = r.queue_depth.load(std::memory_order_relaxed);
+    s.queue_high_water = r.queue_high_water.load(std::memory_order_relaxed);
+    return s;
+}
+
+size_t metrics_thread_sets() {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lck(r.mtx);
+    return r.sets.size();
+}
+
+// ---------------- Отчёт ----------------
+std::string format_metrics(const MetricsSnapshot &d, double seconds) {
+    std::string out;
+    char line[160];
+    double s = seconds > 0 ? seconds : 1;
+
+    std::snprintf(line, sizeof(line), "--- metrics over %.2f s ---\n", seconds);
+    out += line;
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        std::snprintf(line, sizeof(line), "%-10s %12llu  %12.1f/s\n", counter_name(Counter(c)),
+                      static_cast<unsigned long long>(d.counters[c]), d.counters[c] / s);
+        out += line;
+    }
+    std::snprintf(line, sizeof(line), "%-10s %12llu  high water %llu\n", "queue",
+                  static_cast<unsigned long long>(d.queue_depth),
+                  static_cast<unsigned long long>(d.queue_high_water));
+    out += line;
+
+    std::snprintf(line, sizeof(line), "%-10s %10s %10s %10s %10s %10s %9s\n",
+                  "timer, us", "count", "mean", "p50", "p99", "max", "total ms");
+    out += line;
+    for (size_t t = 0; t < TIMER_COUNT; ++t) {
+        const LatencyHistogram &h = d.timers[t];
+        if (!h.count) continue;
+        std::snprintf(line, sizeof(line), "%-10s %10llu %10.1f %10.1f %10.1f %10.1f %9.2f\n",
+                      timer_name(Timer(t)), static_cast<unsigned long long>(h.count),
+                      h.mean() / 1e3, h.percentile(0.5) / 1e3, h.percentile(0.99) / 1e3,
+                      h.max() / 1e3, h.total_ns / 1e6);
+        out += line;
+    }
+    return out;
+}
+
+MetricsReporter::MetricsReporter(const std::string &filename, std::chrono::milliseconds interval_)
+    : interval(interval_), last(metrics_snapshot())
+{
+    // без METRICS отчитываться не о чем: ни файла, ни потока
+    if (!metrics_enabled()) {
+        stopping = true;
+        return;
+    }
+    if (!filename.empty()) {
+        file.open(filename, std::ios::app);
+        to_file = file.is_open();
+    }
+    worker = std::thread(&MetricsReporter::loop, this);
+}
+
+MetricsReporter::~MetricsReporter() {
+    stop();
+}
+
+void MetricsReporter::report() {
+    if (!metrics_enabled()) return;
+    std::lock_guard<std::mutex> lck(mtx);
+    MetricsSnapshot now = metrics_snapshot();
+    std::string text = format_metrics(now - last, std::chrono::duration<double>(now.at - last.at).count());
+    last = now;
+    if (to_file) {
+        file << text;
+        file.flush();
+    } else {
+        std::cerr << text;
+    }
+}
+
+void MetricsReporter::loop() {
+    std::unique_lock<std::mutex> lck(mtx);
+    while (!cv.wait_for(lck, interval, [this] { return stopping; })) {
+        lck.unlock();
+        report();
+        lck.lock();
+    }
+}
+
+void MetricsReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        if (stopping) return;
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) worker.join();
+    report();
+}
@@ -0,0 +1,76 @@
+#include "../include/name_table.h"
+#include "../include/type_registry.h"
+#include <charconv>
+#include <mutex>
+
+NameTable& NameTable::instance() {
+    static NameTable inst;
+    return inst;
+}
+
+NameTable::NameTable() {
+    strings.emplace_back();
+    index.emplace(strings.front(), EMPTY);
+}
+
+// номер после "<тип>_", если имя ровно так и собирается обратно
+static bool parse_numbered(NPCType type, std::string_view name, uint32_t &n) {
+    const std::string &prefix = TypeRegistry::instance().name(type);
+    if (name.size() <= prefix.size() + 1 || name.substr(0, prefix.size()) != prefix ||
+        name[prefix.size()] != '_')
+        return false;
+
+    std::string_view digits = name.substr(prefix.size() + 1);
+    if (digits[0] == '0' && digits.size() > 1) return false;
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), n);
+    return ec == std::errc{} && end == digits.data() + digits.size() && n < NameTable::NUMBERED;
+}
+
+NameId NameTable::intern(NPCType type, std::string_view name) {
+    if (name.empty()) return EMPTY;
+    if (uint32_t n; parse_numbered(type, name, n)) return numbered(n);
+
+    {
+        std::shared_lock<std::shared_mutex> lck(mtx);
+        if (auto it = index.find(name); it != index.end()) return it->second;
+    }
+
+    std::lock_guard<std::shared_mutex> lck(mtx);
+    if (auto it = index.find(name); it != index.end()) return it->second;
+    NameId id = static_cast<NameId>(strings.size());
+    if (id == NUMBERED) return EMPTY;
+    strings.emplace_back(name);
+    index.emplace(strings.back(), id);
+    chars += name.size();
+    return id;
+}
+
+std::string_view NameTable::view(NameId id, NPCType type, std::string &scratch) const {
+    if (is_numbered(id)) {
+        char digits[16];
+        auto end = std::to_chars(digits, digits + sizeof(digits), id & ~NUMBERED).ptr;
+        scratch = TypeRegistry::instance().name(type);
+        scratch += '_';
+        scratch.append(digits, end);
+        return scratch;
+    }
+    std::shared_lock<std::shared_mutex> lck(mtx);
+    return id < strings.size() ? std::string_view(strings[id]) : std::string_view();
+}
+
+std::string NameTable::str(NameId id, NPCType type) const {
+    std::string out;
+    std::string_view v = view(id, type, out);
+    if (v.data() != out.data()) out = v;
+    return out;
+}
+
+size_t NameTable::size() const {
+    std::shared_lock<std::shared_mutex> lck(mtx);
+    return strings.size();
+}
+
+size_t NameTable::bytes() const {
+    std::shared_lock<std::shared_mutex> lck(mtx);
+    return chars;
+}
@@ -7,127 +7,148 @@
 #include "../include/squirrel.h"
 #include "../include/bear.h"
 #include "../include/druid.h"
+#include "../include/creature.h"
+#include "../include/type_registry.h"
+#include "../include/pool.h"
+
+NPC::NPC() : NPC(NPCType::Unknown, "", 0, 0) {}
 
 NPC::NPC(NPCType t, std::string_view nm, int x_, int y_)
-    : type(t), name(nm), x(x_), y(y_)
+    : type(t), name_id(NameTable::instance().intern(t, nm)), handle(NPCWorld::instance().spawn(this, t, x_, y_))
 {}
 
+NPC::~NPC() {
+    NPCWorld::instance().release(handle);
+}
+
 void NPC::subscribe(const std::shared_ptr<IInteractionObserver> &obs) {
     if (!obs) return;
     observers.push_back(obs);
 }
 
-void NPC::notify_interaction(const std::shared_ptr<NPC>& other,
-                       InteractionOutcome outcome)
-{
+void IInteractionObserver::on_batch(std::span<const InteractionRecord> events) {
+    auto &world = NPCWorld::instance();
+    for (auto &e : events) {
+        const NPC *a = world.get(e.actor);
+        const NPC *t = world.get(e.target);
+        if (a && t) on_interaction(*a, *t, e.outcome);
+    }
+}
 
+void NPC::notify_interaction(const NPC& other, InteractionOutcome outcome) const {
     for (auto &o : observers)
-        o->on_interaction(std::shared_ptr<NPC>(this, [](NPC *) {}), other, outcome);
+        o->on_interaction(*this, other, outcome);
+}
+
+std::string NPC::name() const {
+    return NameTable::instance().str(name_id, type);
+}
+
+std::string_view NPC::name(std::string &scratch) const {
+    return NameTable::instance().view(name_id, type, scratch);
 }
 
 void NPC::save(std::ostream &os) const {
-    os << static_cast<int>(type) << ' ' << name << ' ' << x << ' ' << y << '\n';
+    auto [x, y] = position();
+    std::string scratch;
+    os << static_cast<int>(type) << ' ' << name(scratch) << ' ' << x << ' ' << y << '\n';
 }
 
-std::string type_to_string(NPCType t) {
-    switch (t) {
-        case NPCType::Orc:      return "Orc";
-        case NPCType::Squirrel: return "Squirrel";
-        case NPCType::Bear:     return "Bear";
-        case NPCType::Druid:    return "Druid";
-        default:                return "Unknown";
-    }
+const std::string& type_to_string(NPCType t) {
+    return TypeRegistry::instance().name(t);
 }
 
 void NPC::print(std::ostream &os) const {
-    os << name << " [" << type_to_string(type) << "] at (" << x << "," << y << ")";
+    auto [x, y] = position();
+    std::string scratch;
+    os << name(scratch) << " [" << type_to_string(type) << "] at (" << x << "," << y << ")";
 }
 
-bool NPC::is_close(const std::shared_ptr<NPC> &other, int distance) const {
-    if (std::pow(x - other->x, 2) + std::pow(y - other->y, 2) <= std::pow(distance, 2))
-        return true;
-    else
-        return false;
+bool NPC::is_close(const NPC &other, int distance) const {
+    auto [x, y] = position();
+    auto [ox, oy] = other.position();
+    long long dx = x - ox;
+    long long dy = y - oy;
+    return dx * dx + dy * dy <= static_cast<long long>(distance) * distance;
 }
 
 void NPC::move(int shift_x, int shift_y, int max_x, int max_y) {
-    std::lock_guard<std::mutex> lck(mtx);
-
-    if ((x + shift_x >= 0) && (x + shift_x <= max_x))
-        x += shift_x;
-    if ((y + shift_y >= 0) && (y + shift_y <= max_y))
-        y += shift_y;
+    NPCWorld::instance().move(handle.index, shift_x, shift_y, max_x, max_y);
 }
 
 bool NPC::is_alive() const {
-    std::lock_guard<std::mutex> lck(mtx);
-    return alive;
+    return NPCWorld::instance().state(handle.index).alive;
 }
 
 void NPC::must_die() {
-    std::lock_guard<std::mutex> lck(mtx);
-    alive = false;
+    NPCWorld::instance().set_alive(handle.index, false);
 }
 
 void NPC::heal() {
-    std::lock_guard<std::mutex> lck(mtx);
-    alive = true;
+    NPCWorld::instance().set_alive(handle.index, true);
 }
 
 std::pair<int,int> NPC::position() const {
-    std::lock_guard<std::mutex> lck(mtx);
-    return {x, y};
+    NPCState st = NPCWorld::instance().state(handle.index);
+    return {st.x, st.y};
 }
 
 std::string NPC::get_color(NPCType t) const {
-    std::lock_guard<std::mutex> lck(mtx);
-    switch (t) {
-        case NPCType::Orc:      return "\033[31m";
-        case NPCType::Bear:     return "\033[33m";
-        case NPCType::Squirrel: return "\033[32m";
-        case NPCType::Druid:    return "\033[36m";
-        default:                return "\033[35m";
-    }
+    return type_color(t);
+}
+
+const std::string& type_color(NPCType t) {
+    return TypeRegistry::instance().color(t);
 }
 
 int NPC::get_move_distance() const {
-    switch (type) {
-        case NPCType::Orc:      return 20;
-        case NPCType::Bear:     return 5;
-        case NPCType::Squirrel: return 5;
-        case NPCType::Druid:    return 10;
-        default:                return 0;
-    }
+    return move_distance(type);
+}
+
+int move_distance(NPCType t) {
+    return TypeRegistry::instance().type(t).move;
 }
 
 int NPC::get_interaction_distance() const {
-    switch (type) {
-        case NPCType::Orc:      return 10;
-        case NPCType::Bear:     return 10;
-        case NPCType::Squirrel: return 5;
-        case NPCType::Druid:    return 10;
-        default:                return 0;
-    }
+    return interaction_distance(type);
+}
+
+int interaction_distance(NPCType t) {
+    return TypeRegistry::instance().type(t).reach;
 }
 
 bool NPC::get_state(int& x_, int& y_) const {
-    std::lock_guard<std::mutex> lck(mtx);
-    if (!alive) return false;
-    x_ = x;
-    y_ = y;
+    NPCState st = NPCWorld::instance().state(handle.index);
+    if (!st.alive) return false;
+    x_ = st.x;
+    y_ = st.y;
     return true;
 }
 
+// NPC и блок управления shared_ptr - одним блоком из пула своего типа
+template <typename T, typename... Args>
+static std::shared_ptr<NPC> make_pooled(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>{}, std::forward<Args>(args)...);
+}
+
 std::shared_ptr<NPC> createNPC(NPCType type, const std::string &name, int x, int y) {
     switch (type) {
-        case NPCType::Orc:      return std::make_shared<Orc>(name, x, y);
-        case NPCType::Squirrel: return std::make_shared<Squirrel>(name, x, y);
-        case NPCType::Bear:     return std::make_shared<Bear>(name, x, y);
-        case NPCType::Druid:    return std::make_shared<Druid>(name, x, y);
-        default: return nullptr;
+        case NPCType::Orc:      return make_pooled<Orc>(name, x, y);
+        case NPCType::Squirrel: return make_pooled<Squirrel>(name, x, y);
+        case NPCType::Bear:     return make_pooled<Bear>(name, x, y);
+        case NPCType::Druid:    return make_pooled<Druid>(name, x, y);
+        default:
+            if (!TypeRegistry::instance().known(type)) return nullptr;
+            return make_pooled<Creature>(type, name, x, y);
     }
 }
 
+std::shared_ptr<NPC> createNPC(NPCType type, uint32_t number, int x, int y) {
+    auto npc = createNPC(type, std::string(), x, y);
+    if (npc && number < NameTable::NUMBERED) npc->name_id = NameTable::numbered(number);
+    return npc;
+}
+
 std::shared_ptr<NPC> createNPCFromStream(std::istream &is) {
     int t;
     std::string name;
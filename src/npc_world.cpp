@@ -0,0 +1,217 @@
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include "../include/npc_world.h"
+#include "../include/npc.h"
+#include "../include/spatial_grid.h"
+#include "../include/density_map.h"
+#include "../include/simd_kernels.h"
+
+NPCWorld& NPCWorld::instance() {
+    static NPCWorld inst;
+    return inst;
+}
+
+NPCWorld::~NPCWorld() {
+    for (auto &c : chunks)
+        delete c.load();
+}
+
+NPCHandle NPCWorld::spawn(NPC *owner, NPCType type, int x, int y) {
+    std::lock_guard<std::mutex> lck(alloc_mtx);
+
+    uint32_t i;
+    if (!free_slots.empty()) {
+        std::pop_heap(free_slots.begin(), free_slots.end(), std::greater<>());
+        i = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        i = used_slots.load(std::memory_order_relaxed);
+        if (i >> CHUNK_BITS >= MAX_CHUNKS)
+            throw std::length_error("NPCWorld: no free slots");
+        if ((i & MASK) == 0)
+            chunks[i >> CHUNK_BITS].store(new Chunk{}, std::memory_order_release);
+    }
+
+    Chunk &c = chunk(i);
+    c.state[i & MASK].store(NPCState::pack(x, y, true), std::memory_order_release);
+    c.type[i & MASK] = type;
+    c.owner[i & MASK].store(owner, std::memory_order_release);
+    for (DensityMap *d : densities) d->add(type, NPCState::pack(x, y, true));
+    ++live;
+    members.fetch_add(1, std::memory_order_release);
+    mark_dirty(i);
+
+    if (i == used_slots.load(std::memory_order_relaxed))
+        used_slots.store(i + 1, std::memory_order_release);
+
+    return {i, c.generation[i & MASK].load(std::memory_order_relaxed)};
+}
+
+void NPCWorld::release(NPCHandle h) {
+    // guard раньше alloc_mtx: разбор события держит guard и не берёт alloc_mtx
+    std::lock_guard<std::mutex> g(guard(h.index));
+    std::lock_guard<std::mutex> lck(alloc_mtx);
+    if (h.index >= slots()) return;
+
+    Chunk &c = chunk(h.index);
+    uint32_t i = h.index & MASK;
+    if (c.generation[i].load(std::memory_order_relaxed) != h.generation ||
+        !c.owner[i].load(std::memory_order_relaxed))
+        return;
+
+    c.owner[i].store(nullptr, std::memory_order_relaxed);
+    for (DensityMap *d : densities) d->remove(c.type[i], c.state[i].load(std::memory_order_acquire));
+    c.generation[i].store(h.generation + 1, std::memory_order_release);
+    free_slots.push_back(h.index);
+    std::push_heap(free_slots.begin(), free_slots.end(), std::greater<>());
+    --live;
+    members.fetch_add(1, std::memory_order_release);
+    mark_dirty(h.index);
+}
+
+bool NPCWorld::valid(NPCHandle h) const {
+    return get(h) != nullptr;
+}
+
+// поколение до и после чтения владельца: если слот успели освободить
+// и занять заново, второе чтение это увидит
+NPC* NPCWorld::get(NPCHandle h) const {
+    if (h.index >= slots()) return nullptr;
+    const Chunk &c = chunk(h.index);
+    uint32_t i = h.index & MASK;
+    if (c.generation[i].load(std::memory_order_acquire) != h.generation) return nullptr;
+    NPC *p = c.owner[i].load(std::memory_order_acquire);
+    if (!p || c.generation[i].load(std::memory_order_acquire) != h.generation) return nullptr;
+    return p;
+}
+
+size_t NPCWorld::size() const {
+    std::lock_guard<std::mutex> lck(alloc_mtx);
+    return live;
+}
+
+// новое слово после сдвига; границы проверяются по каждой оси отдельно
+static uint64_t shifted(uint64_t w, int shift_x, int shift_y, int max_x, int max_y) {
+    NPCState st = NPCState::unpack(w);
+    if ((st.x + shift_x >= 0) && (st.x + shift_x <= max_x))
+        st.x += shift_x;
+    if ((st.y + shift_y >= 0) && (st.y + shift_y <= max_y))
+        st.y += shift_y;
+    return NPCState::pack(st.x, st.y, st.alive);
+}
+
+void NPCWorld::move(uint32_t i, int shift_x, int shift_y, int max_x, int max_y) {
+    auto &w = chunk(i).state[i & MASK];
+    uint64_t old = w.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = shifted(old, shift_x, shift_y, max_x, max_y);
+        if (next == old) return;
+    } while (!w.compare_exchange_weak(old, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    mark_dirty(i);
+    for (DensityMap *d : densities) d->change(type(i), old, next);
+    if (!grids.empty()) {
+        NPCState st = NPCState::unpack(next);
+        for (SpatialGrid *g : grids) g->relocate(i, st.x, st.y);
+    }
+}
+
+void NPCWorld::set_alive(uint32_t i, bool value) {
+    auto &w = chunk(i).state[i & MASK];
+    uint64_t old = value ? w.fetch_or(NPCState::ALIVE, std::memory_order_acq_rel)
+                         : w.fetch_and(~NPCState::ALIVE, std::memory_order_acq_rel);
+    if (((old & NPCState::ALIVE) != 0) == value) return;
+    mark_dirty(i);
+    for (DensityMap *d : densities) d->change(type(i), old, old ^ NPCState::ALIVE);
+}
+
+void NPCWorld::place(uint32_t i, int nx, int ny) {
+    auto &w = chunk(i).state[i & MASK];
+    uint64_t old = w.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = NPCState::pack(nx, ny, old & NPCState::ALIVE);
+    } while (!w.compare_exchange_weak(old, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+    mark_dirty(i);
+    for (DensityMap *d : densities) d->change(type(i), old, next);
+
+    for (SpatialGrid *g : grids) g->relocate(i, nx, ny);
+}
+
+void NPCWorld::mark_dirty_bits(uint32_t word, uint64_t bits) {
+    uint32_t base = word * 64;
+    uint64_t old = chunk(base).dirty[(base & MASK) >> 6].fetch_or(bits, std::memory_order_acq_rel);
+    if (old == 0)
+        dirty_summary[word / 64].fetch_or(uint64_t(1) << (word & 63), std::memory_order_release);
+}
+
+void NPCWorld::move_all(const std::vector<int> &shift_x, const std::vector<int> &shift_y,
+                        int max_x, int max_y)
+{
+    uint32_t n = std::min<size_t>({slots(), shift_x.size(), shift_y.size()});
+    for (uint32_t base = 0; base < n; base += CHUNK) {
+        Chunk &c = chunk(base);
+        uint32_t len = std::min(n - base, CHUNK);
+
+        // отмечаются все, кому выпал ненулевой сдвиг, даже если его срезала граница
+        for (uint32_t k = 0; k < len; k += 64) {
+            uint32_t m = std::min<uint32_t>(64, len - k);
+            const int *dxs = shift_x.data() + base + k;
+            const int *dys = shift_y.data() + base + k;
+
+            // новые слова считаются пачкой по снимку; обычно писатель
+            // один и CAS со снимком проходит, иначе слот пересчитывается
+            uint64_t old[64], next[64];
+            for (uint32_t b = 0; b < m; ++b) old[b] = c.state[k + b].load(std::memory_order_relaxed);
+            move_batch(old, next, dxs, dys, m, max_x, max_y);
+
+            uint64_t bits = 0;
+            for (uint32_t b = 0; b < m; ++b) {
+                if (!(dxs[b] | dys[b])) continue;
+                bits |= uint64_t(1) << b;
+
+                auto &w = c.state[k + b];
+                uint64_t seen = old[b], to = next[b];
+                while (!w.compare_exchange_weak(seen, to, std::memory_order_acq_rel, std::memory_order_relaxed))
+                    to = shifted(seen, dxs[b], dys[b], max_x, max_y);
+                if (!densities.empty() && c.owner[k + b].load(std::memory_order_relaxed))
+                    for (DensityMap *d : densities) d->change(c.type[k + b], seen, to);
+            }
+            if (bits) mark_dirty_bits((base + k) >> 6, bits);
+        }
+    }
+
+    for (SpatialGrid *g : grids) g->relocate_all(*this);
+}
+
+template <typename T>
+static void add_tracker(std::vector<T*> &list, T *t) {
+    if (std::find(list.begin(), list.end(), t) == list.end()) list.push_back(t);
+}
+
+template <typename T>
+static void remove_tracker(std::vector<T*> &list, T *t) {
+    list.erase(std::remove(list.begin(), list.end(), t), list.end());
+}
+
+void NPCWorld::track(SpatialGrid *g) {
+    std::lock_guard<std::mutex> lck(alloc_mtx);
+    add_tracker(grids, g);
+}
+
+void NPCWorld::untrack(SpatialGrid *g) {
+    std::lock_guard<std::mutex> lck(alloc_mtx);
+    remove_tracker(grids, g);
+}
+
+void NPCWorld::track(DensityMap *d) {
+    std::lock_guard<std::mutex> lck(alloc_mtx);
+    add_tracker(densities, d);
+}
+
+void NPCWorld::untrack(DensityMap *d) {
+    std::lock_guard<std::mutex> lck(alloc_mtx);
+    remove_tracker(densities, d);
+}
@@ -0,0 +1,45 @@
+#include "../include/pool.h"
+#include <algorithm>
+
+FixedPool::FixedPool(size_t size, size_t align_, size_t per_slab_)
+    : align(std::max(align_, alignof(Free))), per_slab(std::max<size_t>(per_slab_, 1))
+{
+    size_t need = std::max(size, sizeof(Free));
+    block = (need + align - 1) / align * align;
+}
+
+FixedPool::~FixedPool() {
+    for (void *s : slab_mem) ::operator delete(s, std::align_val_t(align));
+}
+
+void* FixedPool::allocate() {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!head) {
+        // новая плита целиком уходит в список свободных
+        char *s = static_cast<char*>(::operator new(block * per_slab, std::align_val_t(align)));
+        slab_mem.push_back(s);
+        for (size_t i = per_slab; i-- > 0;)
+            head = new (s + i * block) Free{head};
+    }
+    Free *f = head;
+    head = f->next;
+    ++used;
+    return f;
+}
+
+void FixedPool::deallocate(void *p) {
+    if (!p) return;
+    std::lock_guard<std::mutex> lck(mtx);
+    head = new (p) Free{head};
+    --used;
+}
+
+size_t FixedPool::slabs() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return slab_mem.size();
+}
+
+size_t FixedPool::in_use() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return used;
+}
@@ -0,0 +1,36 @@
+#include "../include/rng.h"
+#include <atomic>
+
+// ---------------- Потоки ----------------
+static std::atomic<uint64_t> global_seed{0};
+static std::atomic<uint64_t> seed_epoch{0};
+static std::atomic<uint32_t> thread_count{0};
+
+RandomStream::RandomStream(StreamKind kind, uint64_t a, uint32_t b)
+    : RandomStream(global_seed.load(std::memory_order_relaxed), kind, a, b) {}
+
+void set_seed(uint64_t seed) {
+    global_seed.store(seed, std::memory_order_relaxed);
+    seed_epoch.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t seed() {
+    return global_seed.load(std::memory_order_relaxed);
+}
+
+RandomStream& rng() {
+    thread_local uint32_t ordinal = thread_count.fetch_add(1, std::memory_order_relaxed);
+    thread_local uint64_t epoch = UINT64_MAX;
+    thread_local RandomStream gen;
+
+    uint64_t now = seed_epoch.load(std::memory_order_acquire);
+    if (epoch != now) {
+        epoch = now;
+        gen = RandomStream(StreamKind::Thread, ordinal);
+    }
+    return gen;
+}
+
+int roll() {
+    return rng().uniform(1, 6);
+}
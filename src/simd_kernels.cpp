@@ -0,0 +1,173 @@
+#include "../include/simd_kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NPC_HAVE_AVX2_KERNELS 1
+#endif
+
+// ---------------- Скалярные версии ----------------
+static constexpr uint64_t ALIVE_BIT = uint64_t(1) << 63;
+
+static void move_batch_scalar(const uint64_t *state, uint64_t *next, const int *dx, const int *dy,
+                              size_t n, int max_x, int max_y)
+{
+    for (size_t k = 0; k < n; ++k) {
+        uint64_t w = state[k];
+        int x = int32_t(uint32_t(w));
+        int y = int32_t(uint32_t(w >> 32) << 1) >> 1;
+        int nx = x + dx[k];
+        int ny = y + dy[k];
+        if (nx >= 0 && nx <= max_x) x = nx;
+        if (ny >= 0 && ny <= max_y) y = ny;
+        next[k] = uint64_t(uint32_t(x)) | uint64_t(uint32_t(y) & 0x7FFFFFFF) << 32 | (w & ALIVE_BIT);
+    }
+}
+
+static void range_mask_scalar(int ax, int ay, int r,
+                              const int *bx, const int *by, const int *br,
+                              size_t n, uint8_t *out)
+{
+    for (size_t k = 0; k < n; ++k) {
+        int dx = bx[k] - ax;
+        int dy = by[k] - ay;
+        int rr = std::max(r, br[k]);
+        out[k] = dx * dx + dy * dy <= rr * rr;
+    }
+}
+
+// ---------------- AVX2 ----------------
+#ifdef NPC_HAVE_AVX2_KERNELS
+// 8 слов за шаг: младшие половины (x) и старшие (y и alive) собираются
+// в два вектора по 8 x 32 бита, после сдвига раскладываются обратно
+__attribute__((target("avx2")))
+static void move_batch_avx2(const uint64_t *state, uint64_t *next, const int *dx, const int *dy,
+                            size_t n, int max_x, int max_y)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i mx = _mm256_set1_epi32(max_x);
+    const __m256i my = _mm256_set1_epi32(max_y);
+    const __m256i alive = _mm256_set1_epi32(int32_t(0x80000000u));
+    const __m256i y_bits = _mm256_set1_epi32(0x7FFFFFFF);
+    const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i a = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state + k)), split);
+        __m256i b = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state + k + 4)), split);
+        __m256i vx = _mm256_permute2x128_si256(a, b, 0x20);
+        __m256i hi = _mm256_permute2x128_si256(a, b, 0x31);
+        __m256i vy = _mm256_srai_epi32(_mm256_slli_epi32(hi, 1), 1);
+
+        __m256i nx = _mm256_add_epi32(vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dx + k)));
+        __m256i ny = _mm256_add_epi32(vy, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dy + k)));
+
+        // вне карты: nx < 0 или nx > max - оставляем старое значение
+        __m256i bad_x = _mm256_or_si256(_mm256_cmpgt_epi32(zero, nx), _mm256_cmpgt_epi32(nx, mx));
+        __m256i bad_y = _mm256_or_si256(_mm256_cmpgt_epi32(zero, ny), _mm256_cmpgt_epi32(ny, my));
+        nx = _mm256_blendv_epi8(nx, vx, bad_x);
+        ny = _mm256_blendv_epi8(ny, vy, bad_y);
+        __m256i nh = _mm256_or_si256(_mm256_and_si256(ny, y_bits), _mm256_and_si256(hi, alive));
+
+        // unpack чередует в пределах 128-битных половин: слова 0,1,4,5 и 2,3,6,7
+        __m256i lo_words = _mm256_unpacklo_epi32(nx, nh);
+        __m256i hi_words = _mm256_unpackhi_epi32(nx, nh);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(next + k),
+                            _mm256_permute2x128_si256(lo_words, hi_words, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(next + k + 4),
+                            _mm256_permute2x128_si256(lo_words, hi_words, 0x31));
+    }
+    move_batch_scalar(state + k, next + k, dx + k, dy + k, n - k, max_x, max_y);
+}
+
+// 8 бит маски -> 8 байт по 0/1
+static const std::array<uint64_t, 256>& byte_masks() {
+    static const std::array<uint64_t, 256> table = [] {
+        std::array<uint64_t, 256> t{};
+        for (unsigned b = 0; b < 256; ++b)
+            for (unsigned j = 0; j < 8; ++j)
+                if (b >> j & 1) t[b] |= uint64_t{1} << (8 * j);
+        return t;
+    }();
+    return table;
+}
+
+__attribute__((target("avx2")))
+static void range_mask_avx2(int ax, int ay, int r,
+                            const int *bx, const int *by, const int *br,
+                            size_t n, uint8_t *out)
+{
+    const __m256i vax = _mm256_set1_epi32(ax);
+    const __m256i vay = _mm256_set1_epi32(ay);
+    const __m256i vr = _mm256_set1_epi32(r);
+
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bx + k)), vax);
+        __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(by + k)), vay);
+        __m256i rr = _mm256_max_epi32(vr, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(br + k)));
+
+        __m256i d2 = _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+        __m256i far = _mm256_cmpgt_epi32(d2, _mm256_mullo_epi32(rr, rr));
+
+        unsigned bits = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(far))) & 0xFF;
+        std::memcpy(out + k, &byte_masks()[bits], 8);
+    }
+    range_mask_scalar(ax, ay, r, bx + k, by + k, br + k, n - k, out + k);
+}
+#endif
+
+// ---------------- Выбор реализации ----------------
+static SimdLevel detect_level() {
+#ifdef NPC_HAVE_AVX2_KERNELS
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+static std::atomic<SimdLevel>& current_level() {
+    static std::atomic<SimdLevel> level{detect_level()};
+    return level;
+}
+
+SimdLevel simd_level() {
+    return current_level().load(std::memory_order_relaxed);
+}
+
+void force_simd_level(SimdLevel level) {
+    if (level == SimdLevel::AVX2 && detect_level() != SimdLevel::AVX2) return;
+    current_level().store(level, std::memory_order_relaxed);
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "avx2";
+        default:              return "scalar";
+    }
+}
+
+void move_batch(const uint64_t *state, uint64_t *next, const int *dx, const int *dy,
+                size_t n, int max_x, int max_y)
+{
+#ifdef NPC_HAVE_AVX2_KERNELS
+    if (simd_level() == SimdLevel::AVX2)
+        return move_batch_avx2(state, next, dx, dy, n, max_x, max_y);
+#endif
+    move_batch_scalar(state, next, dx, dy, n, max_x, max_y);
+}
+
+void range_mask(int ax, int ay, int r,
+                const int *bx, const int *by, const int *br,
+                size_t n, uint8_t *out)
+{
+#ifdef NPC_HAVE_AVX2_KERNELS
+    if (simd_level() == SimdLevel::AVX2)
+        return range_mask_avx2(ax, ay, r, bx, by, br, n, out);
+#endif
+    range_mask_scalar(ax, ay, r, bx, by, br, n, out);
+}
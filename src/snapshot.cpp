@@ -0,0 +1,167 @@
+#include "../include/snapshot.h"
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <tuple>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace snapshot;
+
+static size_t align8(size_t v) {
+    return (v + 7) & ~size_t(7);
+}
+
+Layout snapshot::layout(uint32_t version, uint32_t count, uint64_t names_size) {
+    Layout l{};
+    l.types = sizeof(Header);
+    l.alive = align8(l.types + count);
+    l.xs = align8(l.alive + count);
+    l.ys = l.xs + size_t(count) * sizeof(int32_t);
+    l.slots = l.ys + size_t(count) * sizeof(int32_t);
+    if (version >= 2) l.name_offsets = align8(l.slots + size_t(count) * sizeof(uint32_t));
+    else              l.name_offsets = align8(l.slots);
+    l.names = l.name_offsets + (size_t(count) + 1) * sizeof(uint32_t);
+    l.total = l.names + names_size;
+    return l;
+}
+
+bool is_snapshot(const std::string &filename) {
+    std::ifstream is(filename, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    return is.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool save_snapshot(const std::vector<std::shared_ptr<NPC>> &list, const std::string &filename) {
+    std::vector<const NPC*> npcs;
+    npcs.reserve(list.size());
+    for (auto &p : list)
+        if (p) npcs.push_back(p.get());
+    return save_snapshot(npcs, filename);
+}
+
+// row(i) -> {type, state, slot, name} для i из [0, count)
+template <typename Row>
+static bool write_snapshot(uint32_t count, uint64_t names_size, const std::string &filename,
+                           uint64_t tag, Row &&row)
+{
+    if (names_size > UINT32_MAX) return false;
+
+    Layout l = layout(VERSION, count, names_size);
+    std::vector<char> out(l.total, 0);
+
+    Header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.count = count;
+    h.names_size = names_size;
+    h.tag = tag;
+    std::memcpy(out.data(), &h, sizeof(h));
+
+    uint32_t name_off = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        auto [type, st, slot, name] = row(i);
+        int32_t x = st.x, y = st.y;
+
+        out[l.types + i] = static_cast<char>(type);
+        out[l.alive + i] = st.alive;
+        std::memcpy(out.data() + l.xs + i * sizeof(int32_t), &x, sizeof(x));
+        std::memcpy(out.data() + l.ys + i * sizeof(int32_t), &y, sizeof(y));
+        std::memcpy(out.data() + l.slots + i * sizeof(uint32_t), &slot, sizeof(uint32_t));
+        std::memcpy(out.data() + l.name_offsets + i * sizeof(uint32_t), &name_off, sizeof(name_off));
+        std::memcpy(out.data() + l.names + name_off, name.data(), name.size());
+        name_off += static_cast<uint32_t>(name.size());
+    }
+    std::memcpy(out.data() + l.name_offsets + size_t(count) * sizeof(uint32_t), &name_off, sizeof(name_off));
+
+    std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+    os.write(out.data(), out.size());
+    return os.good();
+}
+
+bool save_snapshot(const std::vector<const NPC*> &npcs, const std::string &filename, uint64_t tag) {
+    uint64_t names_size = 0;
+    std::string scratch;
+    for (const NPC *p : npcs) names_size += p->name(scratch).size();
+
+    auto &world = NPCWorld::instance();
+    return write_snapshot(static_cast<uint32_t>(npcs.size()), names_size, filename, tag, [&](uint32_t i) {
+        const NPC &npc = *npcs[i];
+        return std::tuple{npc.type, world.state(npc.handle.index), npc.handle.index,
+                          npc.name(scratch)};
+    });
+}
+
+bool save_snapshot(const WorldFrame &frame, const std::string &filename, uint64_t tag) {
+    const WorldRoster &r = *frame.roster;
+    return write_snapshot(static_cast<uint32_t>(frame.size()), r.names.size(), filename, tag, [&](uint32_t i) {
+        return std::tuple{r.types[i], frame.states[i], r.slots[i], r.name(i)};
+    });
+}
+
+std::vector<std::shared_ptr<NPC>> load_snapshot(const std::string &filename, SnapshotInfo *info) {
+    std::vector<std::shared_ptr<NPC>> res;
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return res;
+    struct stat sb{};
+    if (::fstat(fd, &sb) != 0 || size_t(sb.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return res;
+    }
+
+    size_t size = size_t(sb.st_size);
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return res;
+    ::madvise(map, size, MADV_SEQUENTIAL);
+    const char *base = static_cast<const char*>(map);
+
+    Header h;
+    std::memcpy(&h, base, sizeof(h));
+    Layout l = layout(h.version, h.count, h.names_size);
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version < 1 || h.version > VERSION ||
+        l.total != size) {
+        ::munmap(map, size);
+        return res;
+    }
+
+    auto types = reinterpret_cast<const uint8_t*>(base + l.types);
+    auto alive = reinterpret_cast<const uint8_t*>(base + l.alive);
+    auto xs = reinterpret_cast<const int32_t*>(base + l.xs);
+    auto ys = reinterpret_cast<const int32_t*>(base + l.ys);
+    auto slots = reinterpret_cast<const uint32_t*>(base + l.slots);
+    auto offs = reinterpret_cast<const uint32_t*>(base + l.name_offsets);
+    const char *names = base + l.names;
+
+    // смещения проверяем до создания NPC: повреждённый файл не должен
+    // оставить в мире половину списка
+    for (uint32_t i = 0; i < h.count; ++i) {
+        if (offs[i] > offs[i + 1] || offs[i + 1] > h.names_size) {
+            ::munmap(map, size);
+            return res;
+        }
+    }
+
+    if (info) {
+        info->tag = h.tag;
+        info->slots.clear();
+        if (h.version >= 2) info->slots.reserve(h.count);
+    }
+
+    auto &world = NPCWorld::instance();
+    res.reserve(h.count);
+    for (uint32_t i = 0; i < h.count; ++i) {
+        auto p = createNPC(static_cast<NPCType>(types[i]),
+                           std::string(names + offs[i], offs[i + 1] - offs[i]), xs[i], ys[i]);
+        if (!p) continue;
+        if (!alive[i]) world.set_alive(p->handle.index, false);
+        if (info && h.version >= 2) info->slots.push_back(slots[i]);
+        res.push_back(std::move(p));
+    }
+
+    ::munmap(map, size);
+    return res;
+}
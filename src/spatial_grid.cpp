@@ -0,0 +1,122 @@
+#include "../include/spatial_grid.h"
+#include "../include/type_registry.h"
+#include <algorithm>
+
+SpatialGrid::SpatialGrid(int max_x, int max_y, int cell_)
+    : cell(std::max(cell_, 1)),
+      cols(max_x / cell + 1),
+      rows(max_y / cell + 1),
+      buckets(static_cast<size_t>(cols) * rows)
+{
+    NPCWorld::instance().track(this);
+}
+
+SpatialGrid::~SpatialGrid() {
+    NPCWorld::instance().untrack(this);
+}
+
+int SpatialGrid::default_cell_size() {
+    int d = 0;
+    auto &types = TypeRegistry::instance();
+    for (size_t t = 1; t < types.size(); ++t)
+        d = std::max(d, types.type(static_cast<NPCType>(t)).reach);
+    return d;
+}
+
+uint32_t SpatialGrid::cell_of(int x, int y) const {
+    int cx = std::clamp(x / cell, 0, cols - 1);
+    int cy = std::clamp(y / cell, 0, rows - 1);
+    return static_cast<uint32_t>(cx + cy * cols);
+}
+
+// Клетке сразу даётся запас: иначе каждый новый рекорд заселённости
+// при переходах NPC между клетками - это поход в кучу посреди тика.
+// Пустые клетки памяти не занимают.
+void SpatialGrid::link(uint32_t index, uint32_t c, int x, int y, int range) {
+    Bucket &b = buckets[c];
+    if (b.ids.capacity() == 0) {
+        b.ids.reserve(BUCKET_RESERVE);
+        b.xs.reserve(BUCKET_RESERVE);
+        b.ys.reserve(BUCKET_RESERVE);
+        b.ranges.reserve(BUCKET_RESERVE);
+    }
+    entries[index].cell = c;
+    entries[index].pos = static_cast<uint32_t>(b.ids.size());
+    b.ids.push_back(index);
+    b.xs.push_back(x);
+    b.ys.push_back(y);
+    b.ranges.push_back(range);
+}
+
+void SpatialGrid::unlink(uint32_t index) {
+    Bucket &b = buckets[entries[index].cell];
+    uint32_t pos = entries[index].pos;
+    uint32_t last = b.ids.back();
+
+    b.ids[pos] = last;
+    b.xs[pos] = b.xs.back();
+    b.ys[pos] = b.ys.back();
+    b.ranges[pos] = b.ranges.back();
+    entries[last].pos = pos;
+
+    b.ids.pop_back();
+    b.xs.pop_back();
+    b.ys.pop_back();
+    b.ranges.pop_back();
+}
+
+void SpatialGrid::insert(const std::shared_ptr<NPC> &npc) {
+    if (!npc) return;
+    auto [x, y] = npc->position();
+    uint32_t index = npc->handle.index;
+
+    std::lock_guard<std::shared_mutex> lck(mtx);
+    if (index >= entries.size()) entries.resize(index + 1);
+    if (entries[index].npc) return;
+
+    entries[index] = {npc, 0, 0, count++};
+    link(index, cell_of(x, y), x, y, npc->get_interaction_distance());
+}
+
+void SpatialGrid::move_entry(uint32_t index, int x, int y) {
+    Entry &e = entries[index];
+    Bucket &b = buckets[e.cell];
+
+    uint32_t c = cell_of(x, y);
+    if (c == e.cell) {
+        b.xs[e.pos] = x;
+        b.ys[e.pos] = y;
+        return;
+    }
+
+    int range = b.ranges[e.pos];
+    unlink(index);
+    link(index, c, x, y, range);
+}
+
+void SpatialGrid::relocate(uint32_t index, int x, int y) {
+    std::lock_guard<std::shared_mutex> lck(mtx);
+    if (index >= entries.size() || !entries[index].npc) return;
+    move_entry(index, x, y);
+}
+
+void SpatialGrid::relocate_all(const NPCWorld &world) {
+    std::lock_guard<std::shared_mutex> lck(mtx);
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i].npc) continue;
+        NPCState st = world.state(i);
+        move_entry(i, st.x, st.y);
+    }
+}
+
+void SpatialGrid::clear() {
+    std::lock_guard<std::shared_mutex> lck(mtx);
+    entries.clear();
+    for (auto &b : buckets) b = Bucket{};
+    count = 0;
+}
+
+size_t SpatialGrid::size() const {
+    std::shared_lock<std::shared_mutex> lck(mtx);
+    return count;
+}
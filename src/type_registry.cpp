@@ -0,0 +1,111 @@
+#include "../include/type_registry.h"
+#include <fstream>
+#include <sstream>
+
+TypeRegistry& TypeRegistry::instance() {
+    static TypeRegistry inst;
+    return inst;
+}
+
+TypeRegistry::TypeRegistry() {
+    reset();
+}
+
+void TypeRegistry::reset() {
+    count = NPC_TYPES;
+    types.fill(TYPE_RULES[0]);
+    rules.fill(rule::NONE);
+    names.fill(std::string(TYPE_LOOKS[0].name));
+    colors.fill(std::string(TYPE_LOOKS[0].color));
+    symbols.fill(TYPE_LOOKS[0].symbol);
+
+    for (size_t a = 0; a < NPC_TYPES; ++a) {
+        types[a] = TYPE_RULES[a];
+        names[a] = TYPE_LOOKS[a].name;
+        colors[a] = TYPE_LOOKS[a].color;
+        symbols[a] = TYPE_LOOKS[a].symbol;
+        for (size_t t = 0; t < NPC_TYPES; ++t)
+            rules[a * MAX_TYPES + t] = PAIR_RULES[a][t];
+    }
+}
+
+NPCType TypeRegistry::find(std::string_view name) const {
+    for (size_t i = 1; i < count; ++i)
+        if (names[i] == name) return static_cast<NPCType>(i);
+    return NPCType::Unknown;
+}
+
+bool TypeRegistry::load(const std::string &filename, std::string *error) {
+    std::ifstream in(filename);
+    if (!in) {
+        if (error) *error = "cannot open " + filename;
+        return false;
+    }
+    return load(in, error);
+}
+
+// ---------------- Разбор файла ----------------
+bool TypeRegistry::load(std::istream &is, std::string *error) {
+    TypeRegistry next(*this);
+    size_t line = 0;
+    auto fail = [&](const std::string &what) {
+        if (error) *error = "line " + std::to_string(line) + ": " + what;
+        return false;
+    };
+
+    std::string text;
+    while (std::getline(is, text)) {
+        ++line;
+        if (size_t hash = text.find('#'); hash != std::string::npos) text.resize(hash);
+        std::istringstream in(text);
+        std::string kind;
+        if (!(in >> kind)) continue;
+
+        if (kind == "type") {
+            std::string name;
+            char symbol;
+            int color, move, reach;
+            if (!(in >> name >> symbol >> color >> move >> reach))
+                return fail("expected: type <name> <symbol> <color> <move> <reach>");
+            if (move < 0 || reach < 0) return fail("negative distance");
+
+            NPCType t = next.find(name);
+            if (t == NPCType::Unknown) {
+                if (next.count == MAX_TYPES) return fail("too many types");
+                t = static_cast<NPCType>(next.count++);
+            }
+            size_t i = index(t);
+            next.types[i] = {move, reach};
+            next.names[i] = name;
+            next.symbols[i] = symbol;
+            next.colors[i] = "\033[";
+            next.colors[i] += std::to_string(color);
+            next.colors[i] += 'm';
+        } else if (kind == "kill" || kind == "heal") {
+            std::string actor, target;
+            int value;
+            if (!(in >> actor >> target >> value))
+                return fail("expected: " + kind + " <actor> <target> <value>");
+
+            NPCType a = next.find(actor), t = next.find(target);
+            if (a == NPCType::Unknown) return fail("unknown type " + actor);
+            if (t == NPCType::Unknown) return fail("unknown type " + target);
+
+            PairRule &r = next.rules[index(a) * MAX_TYPES + index(t)];
+            if (kind == "heal") {
+                r.heal = value != 0;
+            } else {
+                if (value < 0 || value > DICE_OUTCOMES) return fail("kill chance must be 0..36");
+                r.kill = static_cast<uint8_t>(value);
+            }
+        } else {
+            return fail("unknown record " + kind);
+        }
+
+        std::string extra;
+        if (in >> extra) return fail("unexpected " + extra);
+    }
+
+    *this = std::move(next);
+    return true;
+}
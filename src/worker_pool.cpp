@@ -0,0 +1,123 @@
+#include "../include/worker_pool.h"
+#include <algorithm>
+
+// поток уже выполняет кусок какого-то цикла
+static thread_local bool in_pool = false;
+
+WorkerPool::WorkerPool(size_t count)
+    : queues(new Queue[std::max<size_t>(count, 1)])
+{
+    for (size_t i = 1; i < count; ++i)
+        threads.emplace_back(&WorkerPool::worker_loop, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void WorkerPool::push(size_t self, Range r) {
+    std::lock_guard<std::mutex> lck(queues[self].mtx);
+    queues[self].items.push_back(r);
+}
+
+bool WorkerPool::pop(size_t self, Range &r) {
+    std::lock_guard<std::mutex> lck(queues[self].mtx);
+    auto &items = queues[self].items;
+    if (items.empty()) return false;
+    r = items.back();
+    items.pop_back();
+    return true;
+}
+
+bool WorkerPool::steal(size_t self, Range &r) {
+    size_t n = size();
+    for (size_t k = 1; k < n; ++k) {
+        Queue &victim = queues[(self + k) % n];
+        std::lock_guard<std::mutex> lck(victim.mtx);
+        if (victim.items.empty()) continue;
+        r = victim.items.front();
+        victim.items.pop_front();
+        stolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void WorkerPool::work(size_t self) {
+    Range r;
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!pop(self, r) && !steal(self, r)) {
+            // всё роздано, ждём, пока другие доделают свои куски
+            std::this_thread::yield();
+            continue;
+        }
+
+        while (r.end - r.begin > job_grain) {
+            size_t mid = r.begin + (r.end - r.begin) / 2;
+            push(self, {mid, r.end});
+            r.end = mid;
+        }
+
+        (*job)(r.begin, r.end);
+        pending.fetch_sub(r.end - r.begin, std::memory_order_acq_rel);
+    }
+}
+
+void WorkerPool::worker_loop(size_t self) {
+    in_pool = true;
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            start_cv.wait(lck, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        work(self);
+    }
+}
+
+void WorkerPool::parallel_for(size_t n, size_t grain,
+                              const std::function<void(size_t, size_t)>& fn)
+{
+    if (n == 0) return;
+    grain = std::max<size_t>(grain, 1);
+
+    if (threads.empty() || n <= grain || in_pool) {
+        // тот же контракт, что и у пула: куски не больше grain
+        for (size_t begin = 0, end; begin < n; begin = end) {
+            end = begin + std::min(grain, n - begin);
+            fn(begin, end);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(call_mtx);
+    job = &fn;
+    job_grain = grain;
+    pending.store(n, std::memory_order_release);
+
+    // начальная раздача: по равному куску каждому потоку
+    size_t workers = size();
+    for (size_t w = 0; w < workers; ++w) {
+        size_t begin = n * w / workers;
+        size_t end = n * (w + 1) / workers;
+        if (begin < end) push(w, {begin, end});
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        ++generation;
+    }
+    start_cv.notify_all();
+
+    in_pool = true;
+    work(0);
+    in_pool = false;
+}
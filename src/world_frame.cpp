@@ -0,0 +1,63 @@
+#include "../include/world_frame.h"
+#include <atomic>
+
+size_t WorldFrame::alive() const {
+    size_t n = 0;
+    for (auto &st : states) n += st.alive;
+    return n;
+}
+
+std::array<size_t, TypeRegistry::MAX_TYPES> WorldFrame::alive_by_type() const {
+    std::array<size_t, TypeRegistry::MAX_TYPES> res{};
+    for (size_t k = 0; k < states.size(); ++k)
+        if (states[k].alive) ++res[static_cast<size_t>(roster->types[k])];
+    return res;
+}
+
+// ---------------- Публикация ----------------
+std::shared_ptr<WorldFrame> FramePublisher::acquire() {
+    for (auto &f : pool)
+        if (f.use_count() == 1) {
+            // читатель, отпустивший кадр, закончил с ним до этой точки
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return f;
+        }
+    pool.push_back(std::make_shared<WorldFrame>());
+    return pool.back();
+}
+
+static std::shared_ptr<const WorldRoster> build_roster(const NPCWorld &world, uint64_t version) {
+    auto r = std::make_shared<WorldRoster>();
+    r->version = version;
+    std::string scratch;
+    world.for_each([&](uint32_t i) {
+        std::string_view name = world.owner(i)->name(scratch);
+        r->slots.push_back(i);
+        r->types.push_back(world.type(i));
+        r->name_offsets.push_back(static_cast<uint32_t>(r->names.size()));
+        r->names += name;
+    });
+    r->name_offsets.push_back(static_cast<uint32_t>(r->names.size()));
+    return r;
+}
+
+void FramePublisher::publish(const NPCWorld &world, uint64_t tick) {
+    uint64_t version = world.membership();
+    if (!roster || roster->version != version)
+        roster = build_roster(world, version);
+
+    auto frame = acquire();
+    frame->tick = tick;
+    frame->roster = roster;
+    frame->states.resize(roster->size());
+    for (size_t k = 0; k < roster->size(); ++k)
+        frame->states[k] = world.state(roster->slots[k]);
+
+    std::lock_guard<std::mutex> lck(mtx);
+    current = std::move(frame);
+}
+
+std::shared_ptr<const WorldFrame> FramePublisher::latest() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return current;
+}
@@ -7,6 +7,10 @@
 #include <chrono>
 #include <mutex>
 #include <sstream>
+#include <set>
+#include <map>
+#include <tuple>
+#include <array>
 
 #include "../include/npc.h"
 #include "../include/orc.h"
@@ -14,6 +18,17 @@
 #include "../include/bear.h"
 #include "../include/druid.h"
 #include "../include/game_utils.h"
+#include "../include/spatial_grid.h"
+#include "../include/simd_kernels.h"
+#include "../include/async_log.h"
+#include "../include/checkpoint.h"
+#include "../include/engine.h"
+#include "../include/worker_pool.h"
+#include "../include/rng.h"
+#include "../include/alloc_stats.h"
+#include "../include/arena.h"
+#include "../include/name_table.h"
+#include "../include/metrics.h"
 
 using namespace std::chrono_literals;
 
@@ -30,11 +45,10 @@ struct TestObserver : public IInteractionObserver {
     std::vector<Event> events;
     std::mutex mtx;
 
-    void on_interaction(const std::shared_ptr<NPC>& a,
-                  const std::shared_ptr<NPC>& d,
+    void on_interaction(const NPC& a, const NPC& d,
                   InteractionOutcome o) override {
         std::lock_guard<std::mutex> lck(mtx);
-        events.push_back({a->name, d->name, o});
+        events.push_back({a.name(), d.name(), o});
     }
 };
 
@@ -71,44 +85,40 @@ TEST(ObserverTest, ObserverNotCalledIfNoInteraction) {
 TEST(NPCTest, CreateBear) {
     auto b = createNPC(NPCType::Bear, "B", 0, 0);
     EXPECT_EQ(b->type, NPCType::Bear);
-    EXPECT_EQ(b->name, "B");
-    EXPECT_EQ(b->x, 0);
-    EXPECT_EQ(b->y, 0);
+    EXPECT_EQ(b->name(), "B");
+    EXPECT_EQ(b->position(), std::make_pair(0, 0));
 }
 
 TEST(NPCTest, CreateOrc) {
     auto o = createNPC(NPCType::Orc, "O", 1, 1);
     EXPECT_EQ(o->type, NPCType::Orc);
-    EXPECT_EQ(o->name, "O");
-    EXPECT_EQ(o->x, 1);
-    EXPECT_EQ(o->y, 1);
+    EXPECT_EQ(o->name(), "O");
+    EXPECT_EQ(o->position(), std::make_pair(1, 1));
 }
 
 TEST(NPCTest, CreateSquirrel) {
     auto s = createNPC(NPCType::Squirrel, "S", 2, 2);
     EXPECT_EQ(s->type, NPCType::Squirrel);
-    EXPECT_EQ(s->name, "S");
-    EXPECT_EQ(s->x, 2);
-    EXPECT_EQ(s->y, 2);
+    EXPECT_EQ(s->name(), "S");
+    EXPECT_EQ(s->position(), std::make_pair(2, 2));
 }
 
 TEST(NPCTest, NPCTest_CreateDruid_Test) {
     auto d = createNPC(NPCType::Druid, "D", 3, 3);
     EXPECT_EQ(d->type, NPCType::Druid);
-    EXPECT_EQ(d->name, "D");
-    EXPECT_EQ(d->x, 3);
-    EXPECT_EQ(d->y, 3);
+    EXPECT_EQ(d->name(), "D");
+    EXPECT_EQ(d->position(), std::make_pair(3, 3));
 }
 
 TEST(NPCTest, EmptyNameAllowed) {
     auto o = createNPC(NPCType::Orc,"",0,0);
-    EXPECT_EQ(o->name,"");
+    EXPECT_EQ(o->name(),"");
 }
 
 TEST(NPCTest, LongName) {
     std::string name(1000,'x');
     auto b = createNPC(NPCType::Bear,name,0,0);
-    EXPECT_EQ(b->name.size(),1000u);
+    EXPECT_EQ(b->name().size(),1000u);
 }
 
 // ======================================================
@@ -117,8 +127,8 @@ TEST(NPCTest, LongName) {
 TEST(DistanceTest, IsCloseExact) {
     auto a = createNPC(NPCType::Orc,"A",0,0);
     auto b = createNPC(NPCType::Bear,"B",6,8);
-    EXPECT_TRUE(a->is_close(b,a->get_interaction_distance()));
-    EXPECT_FALSE(a->is_close(b,a->get_interaction_distance()-1));
+    EXPECT_TRUE(a->is_close(*b,a->get_interaction_distance()));
+    EXPECT_FALSE(a->is_close(*b,a->get_interaction_distance()-1));
 }
 
 TEST(DistanceTest, KillDistance) {
@@ -133,7 +143,7 @@ TEST(DistanceTest, KillDistance) {
 TEST(CanKillTest, Rule1) {
     auto actor = createNPC(NPCType::Orc, "O1", 0, 0);
     auto target = createNPC(NPCType::Orc, "O2", 0, 0);
-    AttackVisitor v(actor);
+    AttackVisitor v(*actor);
     InteractionOutcome outcome = target->accept(v);
     EXPECT_NE(outcome, InteractionOutcome::NoInteraction);
 }
@@ -141,7 +151,7 @@ TEST(CanKillTest, Rule1) {
 TEST(CanKillTest, Rule2) {
     auto actor = createNPC(NPCType::Orc, "O", 0, 0);
     auto target = createNPC(NPCType::Bear, "B", 0, 0);
-    AttackVisitor v(actor);
+    AttackVisitor v(*actor);
     InteractionOutcome outcome = target->accept(v);
     EXPECT_NE(outcome, InteractionOutcome::NoInteraction);
 }
@@ -149,7 +159,7 @@ TEST(CanKillTest, Rule2) {
 TEST(CanKillTest, Rule3) {
     auto actor = createNPC(NPCType::Orc, "O", 0, 0);
     auto target = createNPC(NPCType::Druid, "D", 0, 0);
-    AttackVisitor v(actor);
+    AttackVisitor v(*actor);
     InteractionOutcome outcome = target->accept(v);
     EXPECT_NE(outcome, InteractionOutcome::NoInteraction);
 }
@@ -157,7 +167,7 @@ TEST(CanKillTest, Rule3) {
 TEST(CanKillTest, Rule4) {
     auto actor = createNPC(NPCType::Bear, "B", 0, 0);
     auto target = createNPC(NPCType::Squirrel, "S", 0, 0);
-    AttackVisitor v(actor);
+    AttackVisitor v(*actor);
     InteractionOutcome outcome = target->accept(v);
     EXPECT_NE(outcome, InteractionOutcome::NoInteraction);
 }
@@ -172,7 +182,7 @@ TEST(DruidSupportTest, HealsDeadBear) {
     bear->must_die();
     ASSERT_FALSE(bear->is_alive());
 
-    SupportVisitor visitor(druid);
+    SupportVisitor visitor(*druid);
     auto outcome = bear->accept(visitor);
 
     EXPECT_EQ(outcome, InteractionOutcome::TargetHealed);
@@ -188,7 +198,7 @@ TEST(DruidSupportTest, HealsDeadSquirrel) {
     squirrel->must_die();
     ASSERT_FALSE(squirrel->is_alive());
 
-    SupportVisitor visitor(druid);
+    SupportVisitor visitor(*druid);
     auto outcome = squirrel->accept(visitor);
 
     EXPECT_EQ(outcome, InteractionOutcome::TargetHealed);
@@ -204,13 +214,105 @@ TEST(DruidSupportTest, HealsDeadOrc) {
     orc->must_die();
     ASSERT_FALSE(orc->is_alive());
 
-    SupportVisitor visitor(druid);
+    SupportVisitor visitor(*druid);
     auto outcome = orc->accept(visitor);
 
     EXPECT_EQ(outcome, InteractionOutcome::NoInteraction);
     EXPECT_FALSE(orc->is_alive());
 }
 
+// ======================================================
+// Rule table
+// ======================================================
+TEST(RulesTest, VisitorsFollowTable) {
+    const std::array<NPCType, 4> types{NPCType::Orc, NPCType::Squirrel, NPCType::Bear, NPCType::Druid};
+    for (NPCType ta : types)
+        for (NPCType tt : types) {
+            auto actor = createNPC(ta, "A", 0, 0);
+            auto target = createNPC(tt, "T", 0, 0);
+            const PairRule &r = TypeRegistry::instance().rule(ta, tt);
+
+            AttackVisitor attack(*actor);
+            EXPECT_EQ(target->accept(attack) != InteractionOutcome::NoInteraction, r.kill > 0);
+
+            target->must_die();
+            SupportVisitor support(*actor);
+            EXPECT_EQ(target->accept(support) == InteractionOutcome::TargetHealed, r.heal);
+        }
+}
+
+TEST(RulesTest, ResolveUsesTable) {
+    auto bear = createNPC(NPCType::Bear, "B", 0, 0);
+    auto squirrel = createNPC(NPCType::Squirrel, "S", 0, 0);
+    auto far = createNPC(NPCType::Squirrel, "F", 11, 0);
+
+    auto &im = InteractionManager::instance();
+    // бросок 15 из 36: за 64 раунда медведь почти наверняка убьёт белку
+    for (uint64_t round = 0; round < 64 && squirrel->is_alive(); ++round)
+        im.resolve_batch({{bear, squirrel}}, nullptr, round);
+    EXPECT_FALSE(squirrel->is_alive());
+
+    // белка медведя не трогает, а до дальней медведь не дотягивается
+    im.resolve_batch({{squirrel, bear}, {bear, far}, {far, bear}}, nullptr, 0);
+    EXPECT_TRUE(bear->is_alive());
+    EXPECT_TRUE(far->is_alive());
+    EXPECT_EQ(interaction_distance(NPCType::Bear), TypeRegistry::instance().type(NPCType::Bear).reach);
+    EXPECT_EQ(move_distance(NPCType::Orc), TypeRegistry::instance().type(NPCType::Orc).move);
+}
+
+// ======================================================
+// Type registry
+// ======================================================
+TEST(RegistryTest, LoadsNewSpecies) {
+    auto &types = TypeRegistry::instance();
+    std::istringstream cfg(
+        "# новый вид\n"
+        "type Wolf W 34 8 10\n"
+        "kill Wolf Squirrel 36   # всегда\n"
+        "type Bear B 33 7 10\n");
+    std::string error;
+    ASSERT_TRUE(types.load(cfg, &error)) << error;
+
+    NPCType wolf = types.find("Wolf");
+    ASSERT_TRUE(types.known(wolf));
+    EXPECT_EQ(static_cast<size_t>(wolf), 5u);
+    EXPECT_EQ(type_to_string(wolf), "Wolf");
+    EXPECT_EQ(move_distance(wolf), 8);
+    EXPECT_EQ(move_distance(NPCType::Bear), 7);
+    EXPECT_EQ(types.rule(wolf, NPCType::Squirrel).kill, 36);
+
+    auto w = createNPC(wolf, "W", 0, 0);
+    auto s = createNPC(NPCType::Squirrel, "S", 3, 4);
+    ASSERT_TRUE(w);
+    EXPECT_EQ(w->type, wolf);
+
+    InteractionManager::instance().resolve_batch({{w, s}}, nullptr, 0);
+    EXPECT_FALSE(s->is_alive());
+    EXPECT_TRUE(w->is_alive());
+
+    AttackVisitor v(*w);
+    EXPECT_NE(createNPC(NPCType::Squirrel, "S2", 0, 0)->accept(v), InteractionOutcome::NoInteraction);
+
+    types.reset();
+    EXPECT_EQ(types.find("Wolf"), NPCType::Unknown);
+    EXPECT_EQ(move_distance(NPCType::Bear), 5);
+}
+
+TEST(RegistryTest, BadFileLeavesRegistry) {
+    auto &types = TypeRegistry::instance();
+    std::istringstream cfg(
+        "type Wolf W 34 8 10\n"
+        "kill Wolf Dragon 10\n");
+    std::string error;
+    EXPECT_FALSE(types.load(cfg, &error));
+    EXPECT_NE(error.find("line 2"), std::string::npos);
+    EXPECT_EQ(types.find("Wolf"), NPCType::Unknown);
+    EXPECT_EQ(types.size(), NPC_TYPES);
+
+    EXPECT_FALSE(types.load("no_such_types.cfg"));
+    EXPECT_FALSE(createNPC(static_cast<NPCType>(7), "X", 0, 0));
+}
+
 // ======================================================
 // Visitor (logic only)
 // ======================================================
@@ -258,10 +360,66 @@ TEST(SaveLoadTest, SaveLoad) {
     auto loaded = load_all("tmp.txt");
 
     EXPECT_EQ(loaded.size(),2u);
-    EXPECT_EQ(loaded[0]->name,"O");
+    EXPECT_EQ(loaded[0]->name(),"O");
     std::remove("tmp.txt");
 }
 
+TEST(SaveLoadTest, BinarySnapshotRoundTrip) {
+    std::vector<std::shared_ptr<NPC>> list{
+        createNPC(NPCType::Orc,"O",1,2),
+        createNPC(NPCType::Druid,"Old Druid",30,40),
+        createNPC(NPCType::Squirrel,"",5,6)
+    };
+    list[1]->must_die();
+
+    save_all(list,"tmp.bin",SaveFormat::Binary);
+    EXPECT_TRUE(is_snapshot("tmp.bin"));
+    auto loaded = load_all("tmp.bin");
+
+    ASSERT_EQ(loaded.size(),3u);
+    EXPECT_EQ(loaded[1]->name(),"Old Druid");
+    EXPECT_EQ(loaded[1]->type,NPCType::Druid);
+    EXPECT_EQ(loaded[1]->position(),std::make_pair(30,40));
+    EXPECT_FALSE(loaded[1]->is_alive());
+    EXPECT_TRUE(loaded[0]->is_alive());
+    EXPECT_EQ(loaded[2]->name(),"");
+    EXPECT_EQ(loaded[2]->type,NPCType::Squirrel);
+    std::remove("tmp.bin");
+}
+
+TEST(SaveLoadTest, TruncatedSnapshotLoadsNothing) {
+    std::vector<std::shared_ptr<NPC>> list{createNPC(NPCType::Bear,"B",2,2)};
+    save_all(list,"tmp.bin",SaveFormat::Binary);
+
+    std::ifstream in("tmp.bin", std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream("tmp.bin", std::ios::binary | std::ios::trunc).write(data.data(), data.size() - 1);
+
+    EXPECT_TRUE(load_all("tmp.bin").empty());
+    std::remove("tmp.bin");
+}
+
+TEST(SaveLoadTest, BadNameOffsetLoadsNothing) {
+    std::vector<std::shared_ptr<NPC>> list{
+        createNPC(NPCType::Bear,"A",2,2),
+        createNPC(NPCType::Orc,"B",3,3)
+    };
+    save_all(list,"tmp.bin",SaveFormat::Binary);
+
+    std::fstream f("tmp.bin", std::ios::binary | std::ios::in | std::ios::out);
+    snapshot::Header h;
+    f.read(reinterpret_cast<char*>(&h), sizeof(h));
+    // первое имя цело, второе уходит за таблицу имён
+    uint32_t bad = uint32_t(h.names_size) + 100;
+    f.seekp(snapshot::layout(h.version, h.count, h.names_size).name_offsets + 2 * sizeof(uint32_t));
+    f.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    f.close();
+
+    EXPECT_TRUE(load_all("tmp.bin").empty());
+    std::remove("tmp.bin");
+}
+
 TEST(SaveLoadTest, SaveLoadEmpty) {
     std::vector<std::shared_ptr<NPC>> empty;
     save_all(empty,"empty.txt");
@@ -272,6 +430,46 @@ TEST(SaveLoadTest, SaveLoadEmpty) {
     std::remove("empty.txt");
 }
 
+TEST(SaveLoadTest, CheckpointReplaysDeltas) {
+    auto keep = createNPC(NPCType::Orc,"ckpt_keep",1,1);
+    auto walker = createNPC(NPCType::Bear,"ckpt_walker",10,10);
+    auto victim = createNPC(NPCType::Squirrel,"ckpt_victim",20,20);
+    auto gone = createNPC(NPCType::Druid,"ckpt_gone",30,30);
+
+    Checkpointer cp("tmp_ckpt.bin");
+    ASSERT_TRUE(cp.write_base());
+    EXPECT_EQ(cp.write_delta(), 0u);
+
+    walker->move(3, -2, 100, 100);
+    victim->must_die();
+    gone.reset();
+    auto born = createNPC(NPCType::Orc,"ckpt_born",7,8);
+    // born занимает освободившийся слот gone: одна запись Spawn вместо двух
+    EXPECT_EQ(cp.write_delta(), 3u);
+
+    victim->heal();
+    walker->move(1, 0, 100, 100);
+    EXPECT_EQ(cp.write_delta(), 2u);
+
+    auto loaded = load_checkpoint("tmp_ckpt.bin");
+    std::map<std::string, std::shared_ptr<NPC>> by_name;
+    for (auto& p : loaded) by_name[p->name()] = p;
+
+    ASSERT_TRUE(by_name.count("ckpt_keep"));
+    ASSERT_TRUE(by_name.count("ckpt_walker"));
+    ASSERT_TRUE(by_name.count("ckpt_victim"));
+    ASSERT_TRUE(by_name.count("ckpt_born"));
+    EXPECT_FALSE(by_name.count("ckpt_gone"));
+
+    EXPECT_EQ(by_name["ckpt_walker"]->position(), std::make_pair(14,8));
+    EXPECT_TRUE(by_name["ckpt_victim"]->is_alive());
+    EXPECT_EQ(by_name["ckpt_born"]->position(), std::make_pair(7,8));
+    EXPECT_EQ(by_name["ckpt_born"]->type, NPCType::Orc);
+
+    std::remove("tmp_ckpt.bin");
+    std::remove("tmp_ckpt.bin.delta");
+}
+
 // ======================================================
 // InteractionManager
 // ======================================================
@@ -292,6 +490,95 @@ TEST(InteractionManagerTest, NoInteractionIfVisitorNotApplicable) {
     EXPECT_TRUE(obs->events.empty());
 }
 
+TEST(InteractionManagerTest, DrainResolvesQueuedEvents) {
+    auto o = createNPC(NPCType::Orc,"O",0,0);
+    auto b = createNPC(NPCType::Bear,"B",0,0);
+
+    auto obs = std::make_shared<TestObserver>();
+    o->subscribe(obs);
+
+    InteractionManager::instance().configure(InteractionManager::DEFAULT_CAPACITY,
+                                             OverflowPolicy::CoalescePair);
+    InteractionManager::instance().push({o,b});
+    EXPECT_EQ(InteractionManager::instance().drain(), 1u);
+    EXPECT_EQ(InteractionManager::instance().drain(), 0u);
+
+    ASSERT_EQ(obs->events.size(), 1u);
+    EXPECT_NE(obs->events[0].outcome, InteractionOutcome::NoInteraction);
+}
+
+TEST(InteractionManagerTest, ParallelResolverKillsOnce) {
+    auto& im = InteractionManager::instance();
+    im.configure(InteractionManager::DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+    im.set_workers(4);
+
+    auto obs = std::make_shared<TestObserver>();
+    std::vector<std::shared_ptr<NPC>> orcs, bears;
+    for (int i = 0; i < 8; ++i) {
+        orcs.push_back(createNPC(NPCType::Orc, uint32_t(i), 0, 0));
+        orcs.back()->subscribe(obs);
+    }
+    for (int i = 0; i < 32; ++i)
+        bears.push_back(createNPC(NPCType::Bear, uint32_t(i), 0, 0));
+
+    for (auto& b : bears)
+        for (auto& o : orcs)
+            im.push({o, b});
+    while (im.drain() > 0) {}
+    im.set_workers(1);
+
+    std::map<std::string, int> kills;
+    for (auto& e : obs->events)
+        if (e.outcome == InteractionOutcome::TargetKilled) ++kills[e.target];
+
+    for (auto& b : bears) {
+        EXPECT_LE(kills[b->name()], 1);
+        EXPECT_EQ(kills[b->name()] == 1, !b->is_alive());
+    }
+}
+
+// Наблюдатель проверяет, что пара ещё на месте в NPCWorld
+struct LiveCheckObserver : public IInteractionObserver {
+    std::atomic<int> calls{0};
+    std::atomic<int> stale{0};
+
+    void on_interaction(const NPC& a, const NPC& d, InteractionOutcome) override {
+        ++calls;
+        std::this_thread::yield();
+        auto &world = NPCWorld::instance();
+        if (world.get(a.handle) != &a || world.get(d.handle) != &d) ++stale;
+    }
+};
+
+TEST(InteractionManagerTest, DestroyWhileDraining) {
+    auto& im = InteractionManager::instance();
+    im.configure(InteractionManager::DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+    auto obs = std::make_shared<LiveCheckObserver>();
+
+    std::atomic<bool> done{false};
+    std::thread consumer([&] {
+        while (!done.load()) {
+            if (im.drain() == 0) std::this_thread::yield();
+        }
+        while (im.drain() > 0) {}
+    });
+
+    for (int i = 0; i < 2000; ++i) {
+        auto o = createNPC(NPCType::Orc, static_cast<uint32_t>(i), 5, 5);
+        auto b = createNPC(NPCType::Bear, static_cast<uint32_t>(i), 5, 5);
+        o->subscribe(obs);
+        b->subscribe(obs);
+        im.push({o, b});
+        im.push({b, o});
+        if (i % 8 == 0) std::this_thread::yield();
+    }   // пара уничтожается, пока поток обработки разбирает очередь
+
+    done = true;
+    consumer.join();
+
+    EXPECT_EQ(obs->stale.load(), 0);
+}
+
 // ======================================================
 // NPC Life
 // ======================================================
@@ -334,6 +621,1362 @@ TEST(MoveTest, MaxMoveBounds) {
     EXPECT_LE(y, 50);
 }
 
+// ======================================================
+// NPC world
+// ======================================================
+TEST(NPCWorldTest, HotFieldsLiveInWorld) {
+    auto& world = NPCWorld::instance();
+    auto b = createNPC(NPCType::Bear, "B", 4, 7);
+    uint32_t i = b->handle.index;
+
+    EXPECT_EQ(world.get(b->handle), b.get());
+    EXPECT_EQ(world.type(i), NPCType::Bear);
+    EXPECT_EQ(world.x(i), 4);
+    EXPECT_EQ(world.y(i), 7);
+
+    b->move(1, -2, MAP_X, MAP_Y);
+    b->must_die();
+    NPCState st = world.state(i);
+    EXPECT_EQ(st.x, 5);
+    EXPECT_EQ(st.y, 5);
+    EXPECT_FALSE(st.alive);
+}
+
+TEST(NPCWorldTest, StaleHandleAfterRelease) {
+    auto& world = NPCWorld::instance();
+    auto o = createNPC(NPCType::Orc, "O", 0, 0);
+    NPCHandle old = o->handle;
+    size_t before = world.size();
+
+    o.reset();
+    EXPECT_FALSE(world.valid(old));
+    EXPECT_EQ(world.get(old), nullptr);
+    EXPECT_EQ(world.size(), before - 1);
+
+    auto s = createNPC(NPCType::Squirrel, "S", 1, 1);
+    EXPECT_EQ(s->handle.index, old.index);
+    EXPECT_NE(s->handle.generation, old.generation);
+    EXPECT_TRUE(world.valid(s->handle));
+}
+
+TEST(NPCWorldTest, MoveAllMatchesMove) {
+    auto& world = NPCWorld::instance();
+    std::vector<std::shared_ptr<NPC>> batch, single;
+    for (int i = 0; i < 40; ++i) {
+        int x = random_coord(0, MAP_X), y = random_coord(0, MAP_Y);
+        batch.push_back(createNPC(NPCType::Orc, "A", x, y));
+        single.push_back(createNPC(NPCType::Orc, "B", x, y));
+    }
+
+    std::vector<int> dx(world.slots(), 0), dy(world.slots(), 0);
+    for (size_t k = 0; k < batch.size(); ++k) {
+        int sx = random_coord(-30, 30), sy = random_coord(-30, 30);
+        dx[batch[k]->handle.index] = sx;
+        dy[batch[k]->handle.index] = sy;
+        single[k]->move(sx, sy, MAP_X, MAP_Y);
+    }
+    world.move_all(dx, dy, MAP_X, MAP_Y);
+
+    for (size_t k = 0; k < batch.size(); ++k)
+        EXPECT_EQ(batch[k]->position(), single[k]->position());
+}
+
+TEST(NPCWorldTest, PackedStateRoundTrip) {
+    for (NPCState st : {NPCState{0, 0, false}, NPCState{-5, -7, true}, NPCState{100000, 32767, true},
+                        NPCState{-(1 << 30), (1 << 30) - 1, false}}) {
+        NPCState back = NPCState::unpack(NPCState::pack(st.x, st.y, st.alive));
+        EXPECT_EQ(back.x, st.x);
+        EXPECT_EQ(back.y, st.y);
+        EXPECT_EQ(back.alive, st.alive);
+    }
+}
+
+TEST(NPCWorldTest, ConcurrentMoveKeepsDeath) {
+    auto& world = NPCWorld::instance();
+    auto o = createNPC(NPCType::Orc, "O", 0, 0);
+    uint32_t i = o->handle.index;
+    constexpr int STEPS = 100000;
+
+    // писатель двигает, второй поток убивает и лечит: ни одно
+    // изменение не должно затереть другое
+    std::thread mover([&] {
+        for (int k = 0; k < STEPS; ++k) world.move(i, 1, 0, STEPS, STEPS);
+    });
+    for (int k = 0; k < STEPS; ++k) {
+        o->must_die();
+        o->heal();
+        NPCState st = world.state(i);
+        ASSERT_TRUE(st.alive);
+        ASSERT_EQ(st.y, 0);
+    }
+    o->must_die();
+    mover.join();
+
+    NPCState st = world.state(i);
+    EXPECT_EQ(st.x, STEPS);
+    EXPECT_FALSE(st.alive);
+}
+
+// ======================================================
+// SIMD kernels
+// ======================================================
+TEST(SimdTest, KernelsMatchScalar) {
+    constexpr size_t N = 1003;
+    std::vector<int> x(N), y(N), r(N);
+    for (size_t k = 0; k < N; ++k) {
+        x[k] = random_coord(0, 1000);
+        y[k] = random_coord(0, 1000);
+        r[k] = random_coord(0, 60);
+    }
+
+    // слова состояния вместе с выходами за карту, отрицательными и живыми
+    std::vector<uint64_t> state(N);
+    std::vector<int> dx(N), dy(N);
+    for (size_t k = 0; k < N; ++k) {
+        state[k] = NPCState::pack(random_coord(-50, 1050), random_coord(-50, 1050), k % 3 != 0);
+        dx[k] = random_coord(-40, 40);
+        dy[k] = random_coord(-40, 40);
+    }
+
+    SimdLevel native = simd_level();
+    force_simd_level(SimdLevel::Scalar);
+    std::vector<uint64_t> snext(N);
+    move_batch(state.data(), snext.data(), dx.data(), dy.data(), N, 1000, 1000);
+    std::vector<uint8_t> smask(N);
+    range_mask(500, 500, 30, x.data(), y.data(), r.data(), N, smask.data());
+
+    force_simd_level(native);
+    std::vector<uint64_t> vnext(N);
+    move_batch(state.data(), vnext.data(), dx.data(), dy.data(), N, 1000, 1000);
+    std::vector<uint8_t> vmask(N);
+    range_mask(500, 500, 30, x.data(), y.data(), r.data(), N, vmask.data());
+
+    EXPECT_EQ(snext, vnext);
+    EXPECT_EQ(smask, vmask);
+
+    // и оба - как NPCWorld::move по одному
+    for (size_t k = 0; k < N; ++k) {
+        NPCState a = NPCState::unpack(state[k]), b = NPCState::unpack(snext[k]);
+        int nx = a.x + dx[k], ny = a.y + dy[k];
+        ASSERT_EQ(b.x, nx >= 0 && nx <= 1000 ? nx : a.x);
+        ASSERT_EQ(b.y, ny >= 0 && ny <= 1000 ? ny : a.y);
+        ASSERT_EQ(b.alive, a.alive);
+    }
+}
+
+// ======================================================
+// Spatial grid
+// ======================================================
+TEST(SpatialGridTest, MatchesAllPairsInRange) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 300; ++i)
+        npcs.push_back(createNPC(random_type(), uint32_t(i),
+                                 random_coord(0, MAP_X), random_coord(0, MAP_Y)));
+
+    SpatialGrid grid(MAP_X, MAP_Y);
+    for (auto& n : npcs) grid.insert(n);
+
+    std::set<std::pair<NPC*, NPC*>> expected;
+    for (size_t i = 0; i < npcs.size(); ++i)
+        for (size_t j = i + 1; j < npcs.size(); ++j) {
+            int r = std::max(npcs[i]->get_interaction_distance(), npcs[j]->get_interaction_distance());
+            if (npcs[i]->is_close(*npcs[j], r))
+                expected.insert({npcs[i].get(), npcs[j].get()});
+        }
+
+    std::set<std::pair<NPC*, NPC*>> found;
+    size_t examined = grid.for_each_candidate_pair([&](const auto& a, const auto& b) {
+        found.insert({a.get(), b.get()});
+    });
+
+    EXPECT_EQ(found, expected);
+    EXPECT_LT(examined, npcs.size() * (npcs.size() - 1) / 2);
+}
+
+TEST(SpatialGridTest, MoveRelocatesNPC) {
+    auto a = createNPC(NPCType::Orc, "A", 0, 0);
+    auto b = createNPC(NPCType::Bear, "B", 90, 90);
+
+    SpatialGrid grid(MAP_X, MAP_Y);
+    grid.insert(a);
+    grid.insert(b);
+
+    size_t pairs = 0;
+    grid.for_each_candidate_pair([&](const auto&, const auto&) { ++pairs; });
+    EXPECT_EQ(pairs, 0u);
+
+    for (int i = 0; i < 9; ++i) a->move(10, 10, MAP_X, MAP_Y);
+    grid.for_each_candidate_pair([&](const auto& actor, const auto& target) {
+        ++pairs;
+        EXPECT_EQ(actor, a);
+        EXPECT_EQ(target, b);
+    });
+    EXPECT_EQ(pairs, 1u);
+}
+
+TEST(SpatialGridTest, SecondGridDoesNotDetachFirst) {
+    auto a = createNPC(NPCType::Orc, "A", 0, 0);
+    auto b = createNPC(NPCType::Bear, "B", 90, 90);
+
+    SpatialGrid grid(MAP_X, MAP_Y);
+    grid.insert(a);
+    grid.insert(b);
+    { SpatialGrid gone(MAP_X, MAP_Y); }
+
+    SpatialGrid other(MAP_X, MAP_Y);
+    other.insert(a);
+    other.insert(b);
+
+    for (int i = 0; i < 9; ++i) a->move(10, 10, MAP_X, MAP_Y);
+    size_t pairs = 0, other_pairs = 0;
+    grid.for_each_candidate_pair([&](const auto&, const auto&) { ++pairs; });
+    other.for_each_candidate_pair([&](const auto&, const auto&) { ++other_pairs; });
+    EXPECT_EQ(pairs, 1u);
+    EXPECT_EQ(other_pairs, 1u);
+}
+
+// ======================================================
+// Interaction queue
+// ======================================================
+TEST(QueueTest, BoundedFifo) {
+    MPSCQueue<int> q(3);
+    EXPECT_EQ(q.capacity(), 4u);
+
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(q.try_push(int(i)));
+    EXPECT_FALSE(q.try_push(4));
+    EXPECT_EQ(q.size(), 4u);
+
+    int v = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(q.try_pop(v));
+        EXPECT_EQ(v, i);
+    }
+    EXPECT_FALSE(q.try_pop(v));
+}
+
+TEST(QueueTest, ManyProducers) {
+    MPSCQueue<int> q(1 << 12);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p)
+        producers.emplace_back([&q] {
+            for (int i = 0; i < 1000; ++i)
+                while (!q.try_push(1)) std::this_thread::yield();
+        });
+    for (auto& t : producers) t.join();
+
+    int sum = 0, v = 0;
+    while (q.try_pop(v)) sum += v;
+    EXPECT_EQ(sum, 4000);
+}
+
+// Без потребителя окно ячеек никто не освобождает: здесь слияние точное,
+// best-effort оно только при одновременном pop
+TEST(QueueTest, CoalesceSamePairManyProducers) {
+    auto& im = InteractionManager::instance();
+    auto o = createNPC(NPCType::Orc,"O",0,0);
+    auto b = createNPC(NPCType::Bear,"B",0,0);
+
+    for (int round = 0; round < 200; ++round) {
+        im.configure(64, OverflowPolicy::CoalescePair);
+        std::atomic<int> go{0};
+        std::atomic<int> accepted{0};
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 4; ++p)
+            producers.emplace_back([&] {
+                ++go;
+                while (go.load() < 4) std::this_thread::yield();
+                if (im.push({o,b})) ++accepted;
+            });
+        for (auto& t : producers) t.join();
+
+        ASSERT_EQ(accepted.load(), 1);
+        EXPECT_EQ(im.stats().depth, 1u);
+        EXPECT_EQ(im.stats().coalesced, 3u);
+    }
+    im.configure(InteractionManager::DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+}
+
+TEST(QueueTest, CoalesceSamePair) {
+    auto& im = InteractionManager::instance();
+    im.configure(8, OverflowPolicy::CoalescePair);
+
+    auto o = createNPC(NPCType::Orc,"O",0,0);
+    auto b = createNPC(NPCType::Bear,"B",0,0);
+    EXPECT_TRUE(im.push({o,b}));
+    EXPECT_FALSE(im.push({o,b}));
+    EXPECT_TRUE(im.push({b,o}));
+
+    auto st = im.stats();
+    EXPECT_EQ(st.depth, 2u);
+    EXPECT_EQ(st.coalesced, 1u);
+    EXPECT_EQ(st.dropped, 0u);
+
+    im.configure(InteractionManager::DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+}
+
+TEST(QueueTest, DropOldestKeepsBound) {
+    auto& im = InteractionManager::instance();
+    im.configure(4, OverflowPolicy::DropOldest);
+
+    auto o = createNPC(NPCType::Orc,"O",0,0);
+    for (int i = 0; i < 6; ++i)
+        im.push({o, createNPC(NPCType::Bear,"B",0,0)});
+
+    auto st = im.stats();
+    EXPECT_EQ(st.depth, 4u);
+    EXPECT_EQ(st.pushed, 6u);
+    EXPECT_EQ(st.dropped, 2u);
+    EXPECT_EQ(st.high_water, 4u);
+
+    im.configure(InteractionManager::DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+}
+
+// ======================================================
+// Async log
+// ======================================================
+// "t<t> <i>\n" дописыванием: сложение с литералом слева
+// даёт ложный -Wrestrict в GCC 12 Release
+static std::string log_line(int t, int i) {
+    std::string s;
+    s.reserve(24);
+    s += 't';
+    s += std::to_string(t);
+    s += ' ';
+    s += std::to_string(i);
+    s += '\n';
+    return s;
+}
+
+TEST(AsyncLogTest, AllThreadsLinesReachFile) {
+    const char *fname = "test_async_log.txt";
+    {
+        AsyncLog log(fname);
+        ASSERT_TRUE(log.good());
+
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; ++t)
+            writers.emplace_back([&log, t] {
+                for (int i = 0; i < 500; ++i)
+                    log.write(log_line(t, i));
+            });
+        for (auto& w : writers) w.join();
+
+        log.flush();
+        EXPECT_GT(log.bytes_written(), 0u);
+        log.close();
+        log.write("after close\n");
+    }
+
+    std::ifstream in(fname);
+    std::set<std::string> lines;
+    std::string line;
+    size_t count = 0;
+    while (std::getline(in, line)) {
+        lines.insert(line);
+        ++count;
+    }
+    EXPECT_EQ(count, 2000u);
+    EXPECT_EQ(lines.size(), 2000u);
+    EXPECT_EQ(lines.count("after close"), 0u);
+    std::remove(fname);
+}
+
+TEST(AsyncLogTest, AcceptedRecordsSurviveConcurrentClose) {
+    const char *fname = "test_async_log_close.txt";
+    std::atomic<size_t> accepted{0};
+    {
+        AsyncLog log(fname);
+        ASSERT_TRUE(log.good());
+
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; ++t)
+            writers.emplace_back([&log, &accepted, t] {
+                for (int i = 0; i < 20000; ++i)
+                    if (log.write(log_line(t, i)))
+                        ++accepted;
+            });
+        std::this_thread::sleep_for(2ms);
+        log.close();
+        for (auto& w : writers) w.join();
+    }
+
+    std::ifstream in(fname);
+    size_t count = 0;
+    std::string line;
+    while (std::getline(in, line)) ++count;
+    EXPECT_EQ(count, accepted.load());
+    std::remove(fname);
+}
+
+TEST(AsyncLogTest, OversizedRecordIsRejectedWhole) {
+    const char *fname = "test_async_log_big.txt";
+    {
+        AsyncLogOptions opts;
+        opts.staging_bytes = 64;
+        AsyncLog log(fname, opts);
+        ASSERT_TRUE(log.good());
+
+        EXPECT_TRUE(log.write(std::string(63, 'a') + "\n"));
+        EXPECT_FALSE(log.write(std::string(64, 'b') + "\n"));
+        EXPECT_TRUE(log.write("c\n"));
+        log.close();
+        EXPECT_FALSE(log.write("after close\n"));
+    }
+
+    std::ifstream in(fname);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) lines.push_back(line);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0], std::string(63, 'a'));
+    EXPECT_EQ(lines[1], "c");
+    std::remove(fname);
+}
+
+// ======================================================
+// Binary event log
+// ======================================================
+TEST(EventLogTest, RoundTrip) {
+    const char *fname = "test_event_log.bin";
+    std::string long_name(40, 'x');
+    auto o = createNPC(NPCType::Orc, long_name, 3, 4);
+    auto b = createNPC(NPCType::Bear, "B", 5, 6);
+    {
+        EventLogWriter log(fname);
+        ASSERT_TRUE(log.good());
+        for (int i = 0; i < 600; ++i)
+            log.write(*o, *b, i % 2 ? InteractionOutcome::TargetKilled : InteractionOutcome::TargetEscaped);
+        log.write(*o, *b, InteractionOutcome::NoInteraction);
+    }
+
+    auto res = read_event_log(fname);
+    ASSERT_TRUE(res.ok) << res.error;
+    ASSERT_EQ(res.events.size(), 600u);
+    EXPECT_EQ(res.bad_blocks, 0u);
+    EXPECT_EQ(res.unverified, 0u);
+    EXPECT_EQ(res.blocks, 3u);
+
+    auto &ev = res.events[1];
+    EXPECT_EQ(ev.actor, long_name);
+    EXPECT_EQ(ev.target, "B");
+    EXPECT_EQ(ev.actor_type, NPCType::Orc);
+    EXPECT_EQ(ev.target_type, NPCType::Bear);
+    EXPECT_EQ(ev.ax, 3);
+    EXPECT_EQ(ev.ty, 6);
+    EXPECT_EQ(ev.outcome, InteractionOutcome::TargetKilled);
+    EXPECT_LE(res.events.front().time_us, res.events.back().time_us);
+    std::remove(fname);
+}
+
+TEST(EventLogTest, CorruptBlockIsSkipped) {
+    const char *fname = "test_event_log.bin";
+    auto o = createNPC(NPCType::Orc, "O", 1, 1);
+    auto b = createNPC(NPCType::Bear, "B", 2, 2);
+    {
+        EventLogWriter log(fname);
+        for (int i = 0; i < 300; ++i)
+            log.write(*o, *b, InteractionOutcome::TargetKilled);
+    }
+    {
+        // испортить координату события во втором блоке
+        std::fstream f(fname, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(sizeof(event_log::Header) + 300 * event_log::RECORD_SIZE + 12);
+        f.put(char(0x7f));
+    }
+
+    auto res = read_event_log(fname);
+    ASSERT_TRUE(res.ok);
+    EXPECT_EQ(res.blocks, 1u);
+    EXPECT_EQ(res.bad_blocks, 1u);
+    EXPECT_EQ(res.events.size(), 254u);
+    std::remove(fname);
+}
+
+TEST(EventLogTest, NamesSurviveCorruptBlock) {
+    const char *fname = "test_event_log.bin";
+    auto o = createNPC(NPCType::Orc, "O", 1, 1);
+    auto b = createNPC(NPCType::Bear, "B", 2, 2);
+    {
+        EventLogWriter log(fname);
+        for (int i = 0; i < 300; ++i)
+            log.write(*o, *b, InteractionOutcome::TargetKilled);
+    }
+    {
+        // испортить имя орка в первом блоке
+        std::fstream f(fname, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(sizeof(event_log::Header) + offsetof(event_log::NameRecord, text));
+        f.put('X');
+    }
+
+    auto res = read_event_log(fname);
+    ASSERT_TRUE(res.ok);
+    EXPECT_EQ(res.bad_blocks, 1u);
+    ASSERT_EQ(res.events.size(), 46u);
+    for (auto &e : res.events) {
+        EXPECT_EQ(e.actor, "O");
+        EXPECT_EQ(e.target, "B");
+    }
+    std::remove(fname);
+}
+
+TEST(EventLogTest, RejectsForeignFile) {
+    const char *fname = "test_event_log.bin";
+    {
+        std::ofstream f(fname);
+        f << "Actor             Type      Pos        Action    \n";
+    }
+    auto res = read_event_log(fname);
+    EXPECT_FALSE(res.ok);
+    EXPECT_FALSE(res.error.empty());
+    std::remove(fname);
+}
+
+TEST(EventLogTest, TableMatchesTextObserver) {
+    char line[256];
+    LogRow row{"Squirrel_1", NPCType::Squirrel, 1, 2, "Orc_2", NPCType::Orc, 3, 4,
+               InteractionOutcome::TargetEscaped};
+    int n = FileObserver::format_row(line, sizeof(line), row);
+    ASSERT_GT(n, 0);
+    std::string s(line, n);
+    EXPECT_EQ(s.rfind("Orc_2", 0), 0u);
+    EXPECT_NE(s.find("escaped"), std::string::npos);
+    EXPECT_NE(s.find("(1,2)"), std::string::npos);
+
+    row.outcome = InteractionOutcome::NoInteraction;
+    EXPECT_EQ(FileObserver::format_row(line, sizeof(line), row), 0);
+}
+
+// ======================================================
+// Worker pool
+// ======================================================
+TEST(WorkerPoolTest, EveryIndexOnce) {
+    WorkerPool pool(4);
+    for (size_t grain : {1u, 7u, 1000u}) {
+        std::vector<std::atomic<int>> hits(10007);
+        pool.parallel_for(hits.size(), grain, [&](size_t b, size_t e) {
+            EXPECT_LE(e - b, grain);
+            for (size_t i = b; i < e; ++i) hits[i]++;
+        });
+        for (auto& h : hits) ASSERT_EQ(h.load(), 1);
+    }
+}
+
+TEST(WorkerPoolTest, NestedCallRunsInline) {
+    WorkerPool pool(3);
+    std::atomic<size_t> total{0};
+    pool.parallel_for(8, 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+            pool.parallel_for(100, 10, [&](size_t b2, size_t e2) {
+                EXPECT_LE(e2 - b2, 10u);
+                total += e2 - b2;
+            });
+    });
+    EXPECT_EQ(total.load(), 800u);
+}
+
+TEST(WorkerPoolTest, InlinePathKeepsGrain) {
+    WorkerPool pool(1);
+    std::vector<std::pair<size_t, size_t>> calls;
+    pool.parallel_for(25, 10, [&](size_t b, size_t e) { calls.emplace_back(b, e); });
+    EXPECT_EQ(calls, (std::vector<std::pair<size_t, size_t>>{{0, 10}, {10, 20}, {20, 25}}));
+}
+
+TEST(WorkerPoolTest, RowSplitFindsSamePairs) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 300; ++i)
+        npcs.push_back(createNPC(random_type(), "N", random_coord(0, 200), random_coord(0, 200)));
+    SpatialGrid grid(200, 200);
+    for (auto& n : npcs) grid.insert(n);
+
+    std::vector<std::pair<NPC*, NPC*>> all, split;
+    grid.for_each_candidate_pair([&](const auto& a, const auto& b) { all.push_back({a.get(), b.get()}); });
+    for (int r = 0; r < grid.cells_y(); ++r)
+        grid.for_each_candidate_pair_in_rows(r, r + 1, [&](const auto& a, const auto& b) {
+            split.push_back({a.get(), b.get()});
+        });
+    EXPECT_EQ(all, split);
+}
+
+TEST(WorkerPoolTest, ParallelMapMatchesSerial) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 200; ++i)
+        npcs.push_back(createNPC(random_type(), "N", random_coord(0, MAP_X), random_coord(0, MAP_Y)));
+    npcs[5]->must_die();
+
+    WorkerPool pool(4);
+    testing::internal::CaptureStdout();
+    draw_map(NPCWorld::instance());
+    std::string serial = testing::internal::GetCapturedStdout();
+    testing::internal::CaptureStdout();
+    draw_map(NPCWorld::instance(), &pool);
+    std::string parallel = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(serial, parallel);
+}
+
+// ======================================================
+// Engine
+// ======================================================
+TEST(EngineTest, UnthrottledRunsExactTicks) {
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    auto o = createNPC(NPCType::Orc,"O",10,10);
+    auto b = createNPC(NPCType::Bear,"B",11,11);
+    engine.add(o);
+    engine.add(b);
+
+    std::vector<uint64_t> seen;
+    engine.on_tick([&](uint64_t t) { seen.push_back(t); }, 2);
+    engine.run_ticks(10);
+
+    auto st = engine.stats();
+    EXPECT_EQ(st.ticks, 10u);
+    EXPECT_EQ(seen, (std::vector<uint64_t>{2, 4, 6, 8, 10}));
+    EXPECT_GT(st.pairs, 0u);
+    for (double ms : st.phase_ms) EXPECT_GE(ms, 0.0);
+}
+
+TEST(EngineTest, FixedRateIsThrottled) {
+    EngineConfig cfg;
+    cfg.tick_rate = 100;
+    Engine engine(cfg);
+
+    engine.run_for(200ms);
+    auto st = engine.stats();
+    EXPECT_GE(st.ticks, 15u);
+    EXPECT_LE(st.ticks, 21u);
+    EXPECT_EQ(st.skipped, 0u);
+}
+
+TEST(EngineTest, SkipDropsLateTicks) {
+    EngineConfig cfg;
+    cfg.tick_rate = 1000;
+    cfg.catch_up = CatchUp::Skip;
+    Engine engine(cfg);
+    engine.on_tick([](uint64_t) { std::this_thread::sleep_for(5ms); });
+
+    engine.run_for(100ms);
+    auto st = engine.stats();
+    EXPECT_LT(st.ticks, 40u);
+    EXPECT_GT(st.skipped, 0u);
+}
+
+TEST(EngineTest, StopFromHook) {
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    engine.on_tick([&](uint64_t t) { if (t == 3) engine.stop(); });
+    engine.run_ticks(100);
+    EXPECT_EQ(engine.tick(), 3u);
+}
+
+TEST(EngineTest, StopBeforeRunIsKept) {
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    engine.stop();
+    engine.run_ticks(100);
+    EXPECT_EQ(engine.tick(), 0u);
+    // стоп израсходован, следующий run идёт как обычно
+    engine.run_ticks(5);
+    EXPECT_EQ(engine.tick(), 5u);
+}
+
+TEST(EngineTest, RateCountsOnlyRunTicks) {
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    for (int i = 0; i < 50; ++i) engine.step();
+    engine.run_ticks(10);
+
+    auto st = engine.stats();
+    EXPECT_EQ(st.ticks, 60u);
+    EXPECT_EQ(st.run_ticks, 10u);
+    ASSERT_GT(st.elapsed_s, 0.0);
+    EXPECT_DOUBLE_EQ(st.ticks_per_s, 10 / st.elapsed_s);
+}
+
+TEST(EngineTest, PublishedFrameIsStable) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 500; ++i)
+        npcs.push_back(createNPC(random_type(), uint32_t(i),
+                                 random_coord(0, MAP_X), random_coord(0, MAP_Y)));
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    for (auto& n : npcs) engine.add(n);
+    EXPECT_EQ(engine.view(), nullptr);
+
+    std::thread sim([&] { engine.run_ticks(300); });
+    uint64_t last = 0;
+    std::shared_ptr<const WorldFrame> held;
+    while (last < 300) {
+        auto f = engine.view();
+        if (!f) continue;
+        EXPECT_GE(f->tick, last);
+        last = f->tick;
+        EXPECT_EQ(f->size(), f->roster->size());
+
+        // удержанный кадр не меняется, пока симуляция идёт дальше
+        if (held) {
+            auto copy = held->states;
+            std::this_thread::yield();
+            for (size_t k = 0; k < copy.size(); ++k) {
+                ASSERT_EQ(copy[k].x, held->states[k].x);
+                ASSERT_EQ(copy[k].alive, held->states[k].alive);
+            }
+        }
+        held = f;
+    }
+    sim.join();
+    held.reset();
+
+    auto f = engine.view();
+    EXPECT_EQ(f->tick, 300u);
+
+    // после остановки кадр совпадает с живыми NPC
+    size_t alive = 0;
+    for (auto& n : npcs) alive += n->is_alive();
+    EXPECT_EQ(f->alive(), alive);
+    auto by_type = f->alive_by_type();
+    EXPECT_EQ(by_type[1] + by_type[2] + by_type[3] + by_type[4], alive);
+
+    testing::internal::CaptureStdout();
+    print_survivors(npcs);
+    std::string live = testing::internal::GetCapturedStdout();
+    testing::internal::CaptureStdout();
+    print_survivors(*f);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), live);
+
+    testing::internal::CaptureStdout();
+    draw_map(NPCWorld::instance());
+    std::string live_map = testing::internal::GetCapturedStdout();
+    testing::internal::CaptureStdout();
+    draw_map(*f);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), live_map);
+}
+
+TEST(EngineTest, FrameBuffersAreReused) {
+    auto o = createNPC(NPCType::Orc, "O", 1, 1);
+    FramePublisher pub;
+    std::shared_ptr<const WorldFrame> reader;
+    for (uint64_t t = 1; t <= 100; ++t) {
+        pub.publish(NPCWorld::instance(), t);
+        if (t % 3 == 0) reader = pub.latest();
+    }
+    EXPECT_LE(pub.buffers(), 3u);
+    EXPECT_EQ(pub.latest()->tick, 100u);
+    EXPECT_EQ(reader->tick, 99u);
+}
+
+TEST(EngineTest, FrameSnapshotLoads) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 50; ++i)
+        npcs.push_back(createNPC(random_type(), uint32_t(i),
+                                 random_coord(0, MAP_X), random_coord(0, MAP_Y)));
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    Engine engine(cfg);
+    for (auto& n : npcs) engine.add(n);
+    engine.run_ticks(5);
+
+    auto f = engine.view();
+    ASSERT_TRUE(save_snapshot(*f, "frame.bin"));
+    std::vector<std::tuple<std::string, int, int, bool>> saved, loaded;
+    for (size_t k = 0; k < f->size(); ++k)
+        saved.emplace_back(std::string(f->roster->name(k)), f->states[k].x, f->states[k].y, f->states[k].alive);
+    for (auto& p : load_all("frame.bin")) {
+        auto [x, y] = p->position();
+        loaded.emplace_back(p->name(), x, y, p->is_alive());
+    }
+    EXPECT_EQ(saved, loaded);
+    std::remove("frame.bin");
+}
+
+// ======================================================
+// Map renderer
+// ======================================================
+static size_t count_of(const std::string& s, const std::string& what) {
+    size_t n = 0;
+    for (size_t p = s.find(what); p != std::string::npos; p = s.find(what, p + 1)) ++n;
+    return n;
+}
+
+TEST(MapRendererTest, ColorOnlyOnChange) {
+    MapRenderer r(4, 2, 40, 20);
+    r.put(NPCType::Orc, 0, 0, true);
+    r.put(NPCType::Orc, 10, 0, false);
+    r.put(NPCType::Bear, 20, 0, true);
+    std::string out = r.compose();
+
+    EXPECT_EQ(count_of(out, type_color(NPCType::Orc)), 1u);
+    EXPECT_EQ(count_of(out, type_color(NPCType::Bear)), 1u);
+    EXPECT_NE(out.find("[O][*]" + type_color(NPCType::Bear) + "[B]"), std::string::npos);
+    EXPECT_EQ(out.substr(0, 13), "============\n");
+    EXPECT_EQ(r.changed(), 8u);
+}
+
+TEST(MapRendererTest, DiffRedrawsOnlyChangedCells) {
+    MapRenderer r(50, 50, 100, 100, RenderMode::Diff);
+    r.put(NPCType::Druid, 10, 10, true);
+    std::string first = r.compose();
+    EXPECT_EQ(first.rfind("\033[H\033[2J", 0), 0u);
+
+    r.clear();
+    r.put(NPCType::Druid, 10, 10, true);
+    EXPECT_TRUE(r.compose().empty());
+    EXPECT_EQ(r.changed(), 0u);
+
+    // друид ушёл на клетку вправо: старая клетка пустеет, новая рисуется
+    r.clear();
+    r.put(NPCType::Druid, 12, 10, false);
+    std::string diff = r.compose();
+    EXPECT_EQ(r.changed(), 2u);
+    EXPECT_EQ(diff.find("\033[7;16H"), 0u);
+    EXPECT_NE(diff.find("[ ]" + type_color(NPCType::Druid) + "[*]"), std::string::npos);
+    EXPECT_LT(diff.size(), 64u);
+}
+
+TEST(MapRendererTest, DrawMapWritesOneFrame) {
+    std::vector<std::shared_ptr<NPC>> npcs{createNPC(NPCType::Squirrel, "S", 50, 50)};
+    testing::internal::CaptureStdout();
+    draw_map(npcs);
+    std::string out = testing::internal::GetCapturedStdout();
+
+    MapRenderer r(GRID, GRID, MAP_X, MAP_Y);
+    r.put(NPCType::Squirrel, 50, 50, true);
+    EXPECT_EQ(out, r.compose());
+}
+
+// ======================================================
+// Density map
+// ======================================================
+// пересчёт с нуля по живым объектам NPC
+static std::vector<uint32_t> recount(const DensityMap& map) {
+    auto& world = NPCWorld::instance();
+    std::vector<uint32_t> res(map.cells() * map.types() * 2, 0);
+    world.for_each([&](uint32_t i) {
+        NPCState st = world.state(i);
+        size_t c = map.cell_of(st.x, st.y);
+        ++res[c * map.types() * 2 + size_t(world.type(i)) * 2 + st.alive];
+    });
+    return res;
+}
+
+static std::vector<uint32_t> counted(const DensityMap& map) {
+    std::vector<uint32_t> res;
+    for (size_t c = 0; c < map.cells(); ++c)
+        for (size_t t = 0; t < map.types(); ++t)
+            for (bool alive : {false, true})
+                res.push_back(map.count(c, static_cast<NPCType>(t), alive));
+    return res;
+}
+
+TEST(DensityMapTest, FollowsEveryChange) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 100; ++i)
+        npcs.push_back(createNPC(random_type(), "D", random_coord(0, 300), random_coord(0, 300)));
+    DensityMap map(16, 16, 300, 300);
+    EXPECT_EQ(counted(map), recount(map));
+
+    // движок: move_all, смерти и лечение; плюс рождения, уходы и place
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    cfg.max_x = 300;
+    cfg.max_y = 300;
+    Engine engine(cfg);
+    for (auto& n : npcs) engine.add(n);
+    engine.run_ticks(30);
+    EXPECT_EQ(counted(map), recount(map));
+
+    npcs.resize(60);
+    for (int i = 0; i < 20; ++i)
+        npcs.push_back(createNPC(random_type(), "E", random_coord(0, 300), random_coord(0, 300)));
+    npcs[0]->move(7, -3, 300, 300);
+    NPCWorld::instance().place(npcs[1]->handle.index, 299, 0);
+    npcs[2]->must_die();
+    npcs[2]->must_die();
+    npcs[3]->heal();
+    EXPECT_EQ(counted(map), recount(map));
+}
+
+TEST(DensityMapTest, MajorityAndDensityRender) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.push_back(createNPC(NPCType::Orc, "O1", 1, 1));
+    npcs.push_back(createNPC(NPCType::Orc, "O2", 2, 2));
+    npcs.push_back(createNPC(NPCType::Bear, "B1", 3, 3));
+    npcs.push_back(createNPC(NPCType::Squirrel, "S1", 99, 99));
+    npcs.back()->must_die();
+
+    DensityMap map(2, 2, 100, 100);
+    MapRenderer r(2, 2, 100, 100);
+    map.render(r, HeatMode::Majority);
+    std::string out = r.compose();
+    EXPECT_NE(out.find(type_color(NPCType::Orc) + "[O]"), std::string::npos);
+    EXPECT_NE(out.find("[*]"), std::string::npos);
+
+    // самая людная клетка получает верх шкалы
+    map.render(r, HeatMode::Density);
+    out = r.compose();
+    uint32_t top = map.total(map.cell_of(1, 1));
+    EXPECT_GE(top, 3u);
+    EXPECT_EQ(map.alive(map.cell_of(99, 99)), 0u);
+    EXPECT_NE(out.find("[@]"), std::string::npos);
+}
+
+TEST(DensityMapTest, RegisteredTypesUseTheirSymbol) {
+    auto &types = TypeRegistry::instance();
+    DensityMap before(2, 2, 100, 100);     // ещё без нового типа
+
+    std::istringstream cfg("type Golem g 33 1 3\n");
+    ASSERT_TRUE(types.load(cfg));
+    NPCType golem = types.find("Golem");
+    {
+        auto g1 = createNPC(golem, "G1", 1, 1);
+        auto g2 = createNPC(golem, "G2", 2, 2);
+        DensityMap map(2, 2, 100, 100);
+        MapRenderer r(2, 2, 100, 100);
+        map.render(r, HeatMode::Majority);
+        EXPECT_NE(r.compose().find("[g]"), std::string::npos);
+
+        // карта, созданная раньше типа, считает его как Unknown
+        EXPECT_EQ(before.count(before.cell_of(1, 1), NPCType::Unknown, true), 2u);
+        EXPECT_EQ(before.total(before.cell_of(1, 1)), 2u);
+    }
+    types.reset();
+}
+
+// ======================================================
+// Random streams
+// ======================================================
+TEST(RandomTest, PhiloxKnownAnswer) {
+    // контрольные значения Random123 для Philox4x32-10
+    EXPECT_EQ(philox::block({0, 0, 0, 0}, {0, 0}),
+              (philox::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    EXPECT_EQ(philox::block({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+              (philox::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+}
+
+TEST(RandomTest, StreamsDependOnlyOnTheirKey) {
+    RandomStream a(7, StreamKind::Move, 3, 11), b(7, StreamKind::Move, 3, 11);
+    RandomStream other(7, StreamKind::Dice, 3, 11), reseeded(8, StreamKind::Move, 3, 11);
+    bool differs = false, differs_seed = false;
+    for (int i = 0; i < 100; ++i) {
+        uint32_t x = a();
+        EXPECT_EQ(x, b());
+        differs |= x != other();
+        differs_seed |= x != reseeded();
+    }
+    EXPECT_TRUE(differs);
+    EXPECT_TRUE(differs_seed);
+
+    std::array<int, 6> faces{};
+    for (int i = 0; i < 6000; ++i) {
+        int v = a.uniform(1, 6);
+        ASSERT_GE(v, 1);
+        ASSERT_LE(v, 6);
+        ++faces[v - 1];
+    }
+    for (int f : faces) EXPECT_GT(f, 800);
+}
+
+TEST(RandomTest, SetSeedRestartsThreadStream) {
+    set_seed(123);
+    std::vector<int> first;
+    for (int i = 0; i < 10; ++i) first.push_back(random_coord(0, 1000));
+    set_seed(123);
+    std::vector<int> second;
+    for (int i = 0; i < 10; ++i) second.push_back(random_coord(0, 1000));
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(seed(), 123u);
+}
+
+TEST(RandomTest, ResolveLeavesThreadStreamAlone) {
+    auto o = createNPC(NPCType::Orc, "O", 0, 0);
+    auto b = createNPC(NPCType::Bear, "B", 0, 0);
+
+    set_seed(7);
+    std::vector<int> expected;
+    for (int i = 0; i < 10; ++i) expected.push_back(random_coord(0, 1000));
+
+    set_seed(7);
+    std::vector<int> got;
+    for (int i = 0; i < 10; ++i) {
+        InteractionManager::instance().resolve_batch({{o, b}}, nullptr, i);
+        got.push_back(random_coord(0, 1000));
+    }
+    EXPECT_EQ(got, expected);
+}
+
+TEST(RandomTest, EngineReplayIsIndependentOfThreads) {
+    auto play = [](uint64_t s, size_t workers) {
+        set_seed(s);
+        std::vector<std::shared_ptr<NPC>> npcs;
+        for (int i = 0; i < 2000; ++i)
+            npcs.push_back(createNPC(random_type(), uint32_t(i),
+                                     random_coord(0, 300), random_coord(0, 300)));
+
+        EngineConfig cfg;
+        cfg.tick_rate = 0;
+        cfg.workers = workers;
+        cfg.max_x = 300;
+        cfg.max_y = 300;
+        Engine engine(cfg);
+        for (auto& n : npcs) engine.add(n);
+        engine.run_ticks(40);
+
+        std::vector<std::tuple<std::string, int, int>> survivors;
+        for (auto& n : npcs)
+            if (n->is_alive()) {
+                auto [x, y] = n->position();
+                survivors.emplace_back(n->name(), x, y);
+            }
+        return survivors;
+    };
+
+    auto one = play(2024, 1);
+    EXPECT_FALSE(one.empty());
+    EXPECT_LT(one.size(), 2000u);
+    EXPECT_EQ(one, play(2024, 2));
+    EXPECT_EQ(one, play(2024, 4));
+    EXPECT_NE(one, play(2025, 4));
+}
+
+// ======================================================
+// Event bus
+// ======================================================
+struct BatchObserver : IInteractionObserver {
+    std::vector<size_t> batches;
+    std::vector<InteractionRecord> events;
+    size_t single{0};
+
+    void on_interaction(const NPC&, const NPC&, InteractionOutcome) override { ++single; }
+    void on_batch(std::span<const InteractionRecord> ev) override {
+        batches.push_back(ev.size());
+        events.insert(events.end(), ev.begin(), ev.end());
+    }
+};
+
+TEST(EventBusTest, DeliversTickAsOneBatch) {
+    auto &bus = EventBus::instance();
+    auto all = std::make_shared<BatchObserver>();
+    auto heals = std::make_shared<BatchObserver>();
+    auto t1 = bus.subscribe(all);
+    auto t2 = bus.subscribe(heals, {.outcomes = EventFilter::bit(InteractionOutcome::TargetHealed)});
+
+    std::vector<std::shared_ptr<NPC>> npcs;
+    std::vector<InteractionEvent> events;
+    for (int i = 0; i < 50; ++i) {
+        auto o = createNPC(NPCType::Orc, "O", 0, 0);
+        auto b = createNPC(NPCType::Bear, "B", 0, 0);
+        events.push_back({o, b});
+        npcs.push_back(o);
+        npcs.push_back(b);
+    }
+    auto druid = createNPC(NPCType::Druid, "D", 0, 0);
+    auto squirrel = createNPC(NPCType::Squirrel, "S", 0, 0);
+    squirrel->must_die();
+    events.push_back({druid, squirrel});
+
+    InteractionManager::instance().resolve_batch(events, nullptr, 0);
+    EXPECT_GE(bus.flush(), 51u);
+    EXPECT_EQ(bus.flush(), 0u);
+
+    ASSERT_EQ(all->batches.size(), 1u);
+    EXPECT_EQ(all->batches[0], all->events.size());
+    EXPECT_EQ(all->single, 0u);
+    ASSERT_EQ(heals->events.size(), 1u);
+    EXPECT_EQ(heals->events[0].actor, druid->handle);
+    EXPECT_EQ(heals->events[0].target_type, NPCType::Squirrel);
+
+    // на каждую пару орк-медведь хотя бы одно нападение
+    size_t orc_attacks = std::count_if(all->events.begin(), all->events.end(), [](auto &e) {
+        return e.actor_type == NPCType::Orc && e.outcome != InteractionOutcome::TargetHealed;
+    });
+    EXPECT_EQ(orc_attacks, 50u);
+
+    bus.unsubscribe(t1);
+    bus.unsubscribe(t2);
+    EXPECT_EQ(bus.subscribers(), 0u);
+    squirrel->must_die();
+    InteractionManager::instance().resolve_batch({{druid, squirrel}}, nullptr, 1);
+    EXPECT_EQ(bus.flush(), 0u);
+}
+
+TEST(EventBusTest, DefaultBatchCallsOnInteraction) {
+    auto obs = std::make_shared<TestObserver>();
+    auto token = EventBus::instance().subscribe(obs);
+
+    auto druid = createNPC(NPCType::Druid, "D", 0, 0);
+    auto bear = createNPC(NPCType::Bear, "B", 0, 0);
+    bear->must_die();
+    InteractionManager::instance().resolve_batch({{druid, bear}}, nullptr, 0);
+    EventBus::instance().flush();
+    EventBus::instance().unsubscribe(token);
+
+    ASSERT_EQ(obs->events.size(), 1u);
+    EXPECT_EQ(obs->events[0].actor, "D");
+    EXPECT_EQ(obs->events[0].target, "B");
+    EXPECT_EQ(obs->events[0].outcome, InteractionOutcome::TargetHealed);
+}
+
+TEST(EventBusTest, EngineFlushesEveryTick) {
+    auto obs = std::make_shared<BatchObserver>();
+    auto token = EventBus::instance().subscribe(obs);
+    {
+        EngineConfig cfg;
+        cfg.tick_rate = 0;
+        cfg.max_x = 20;
+        cfg.max_y = 20;
+        Engine engine(cfg);
+        std::vector<std::shared_ptr<NPC>> npcs;
+        for (int i = 0; i < 40; ++i) {
+            npcs.push_back(createNPC(i % 2 ? NPCType::Orc : NPCType::Bear, "N", i % 20, i % 20));
+            engine.add(npcs.back());
+        }
+        engine.run_ticks(5);
+    }
+    EventBus::instance().unsubscribe(token);
+
+    EXPECT_FALSE(obs->batches.empty());
+    EXPECT_LE(obs->batches.size(), 5u);
+}
+
+// ======================================================
+// Allocations
+// ======================================================
+TEST(AllocTest, ArenaResetReusesBlocks) {
+    Arena arena(1024);
+    for (int round = 0; round < 3; ++round) {
+        auto before = alloc_stats();
+        int *a = arena.allocate_array<int>(100);
+        double *b = arena.allocate_array<double>(200);     // не влезает в первый блок
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % alignof(double), 0u);
+        a[99] = 1;
+        b[199] = 2.0;
+        EXPECT_GE(arena.used(), 100 * sizeof(int) + 200 * sizeof(double));
+        if (round > 0) {
+            EXPECT_EQ((alloc_stats() - before).allocations, 0u);
+        }
+        arena.reset();
+        EXPECT_EQ(arena.used(), 0u);
+    }
+}
+
+TEST(AllocTest, PooledNPCsReuseBlocks) {
+    if (!alloc_stats_enabled()) GTEST_SKIP() << "built without ALLOC_STATS";
+    auto churn = [] {
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(1000);
+        for (int i = 0; i < 1000; ++i)
+            npcs.push_back(createNPC(static_cast<NPCType>(1 + i % 4), "N", i, i));
+    };
+    churn();
+
+    std::vector<std::shared_ptr<NPC>> keep;
+    keep.reserve(1000);
+    auto before = alloc_stats();
+    for (int i = 0; i < 1000; ++i)
+        keep.push_back(createNPC(static_cast<NPCType>(1 + i % 4), "N", i, i));
+    keep.clear();
+    EXPECT_EQ((alloc_stats() - before).allocations, 0u);
+
+    std::istringstream in("1 Orc_1 3 4\n");
+    before = alloc_stats();
+    auto loaded = createNPCFromStream(in);
+    ASSERT_TRUE(loaded);
+    loaded.reset();
+    // только строка имени внутри разбора потока; сам NPC из пула
+    EXPECT_LE((alloc_stats() - before).allocations, 1u);
+}
+
+TEST(AllocTest, SteadyTickIsAllocationFree) {
+    if (!alloc_stats_enabled()) GTEST_SKIP() << "built without ALLOC_STATS";
+    struct Counting : IInteractionObserver {
+        size_t events{0};
+        void on_interaction(const NPC&, const NPC&, InteractionOutcome) override {}
+        void on_batch(std::span<const InteractionRecord> ev) override { events += ev.size(); }
+    };
+    auto obs = std::make_shared<Counting>();
+    auto token = EventBus::instance().subscribe(obs);
+    auto kills = EventBus::instance().subscribe(std::make_shared<Counting>(),
+                                                {.outcomes = EventFilter::bit(InteractionOutcome::TargetKilled)});
+
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    // 10x10 клеток без узкой крайней, все заняты с первого тика:
+    // прогрев - это запас клеток сетки и ёмкость буферов шины
+    cfg.max_x = 99;
+    cfg.max_y = 99;
+    Engine engine(cfg);
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 500; ++i) {
+        npcs.push_back(createNPC(static_cast<NPCType>(1 + i % 4), "N", rng().uniform(0, 99), rng().uniform(0, 99)));
+        engine.add(npcs.back());
+    }
+    engine.run_ticks(30);
+
+    auto before = alloc_stats();
+    engine.run_ticks(50);
+    auto delta = alloc_stats() - before;
+    EventBus::instance().unsubscribe(token);
+    EventBus::instance().unsubscribe(kills);
+
+    EXPECT_GT(obs->events, 0u);
+    EXPECT_EQ(delta.allocations, 0u) << delta.bytes << " bytes";
+}
+
+TEST(AllocTest, QueueIsAllocationFree) {
+    if (!alloc_stats_enabled()) GTEST_SKIP() << "built without ALLOC_STATS";
+    auto &im = InteractionManager::instance();
+    im.configure(1024, OverflowPolicy::DropOldest);
+    auto o = createNPC(NPCType::Orc, "O", 0, 0);
+    auto b = createNPC(NPCType::Bear, "B", 0, 0);
+
+    auto round = [&] {
+        for (int i = 0; i < 500; ++i) im.push({o, b});
+        while (im.drain() > 0) {}
+        b->heal();
+        o->heal();
+    };
+    round();
+    auto before = alloc_stats();
+    for (int r = 0; r < 10; ++r) round();
+    EXPECT_EQ((alloc_stats() - before).allocations, 0u);
+
+    im.configure(InteractionManager::DEFAULT_CAPACITY, OverflowPolicy::CoalescePair);
+}
+
+// ======================================================
+// Names
+// ======================================================
+TEST(NameTest, NumberedNamesAreNotStored) {
+    auto &names = NameTable::instance();
+    size_t before = names.size();
+
+    auto o = createNPC(NPCType::Orc, "Orc_17", 0, 0);
+    auto b = createNPC(NPCType::Bear, 42u, 0, 0);
+    EXPECT_TRUE(NameTable::is_numbered(o->name_id));
+    EXPECT_EQ(o->name(), "Orc_17");
+    EXPECT_EQ(b->name(), "Bear_42");
+    EXPECT_EQ(names.size(), before);
+
+    // не тот префикс и ведущий ноль в номер не превращаются
+    auto s = createNPC(NPCType::Squirrel, "Orc_3", 0, 0);
+    auto z = createNPC(NPCType::Squirrel, "Squirrel_007", 0, 0);
+    EXPECT_FALSE(NameTable::is_numbered(s->name_id));
+    EXPECT_EQ(s->name(), "Orc_3");
+    EXPECT_EQ(z->name(), "Squirrel_007");
+}
+
+TEST(NameTest, EqualNamesShareEntry) {
+    auto a = createNPC(NPCType::Druid, "Old Oak", 0, 0);
+    size_t after_first = NameTable::instance().size();
+    auto b = createNPC(NPCType::Bear, "Old Oak", 0, 0);
+    EXPECT_EQ(a->name_id, b->name_id);
+    EXPECT_EQ(NameTable::instance().size(), after_first);
+
+    std::string scratch;
+    EXPECT_EQ(b->name(scratch), "Old Oak");
+    EXPECT_TRUE(scratch.empty());
+}
+
+// ======================================================
+// Metrics
+// ======================================================
+TEST(MetricsTest, HistogramBucketsBoundValues) {
+    for (uint64_t v : {0ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull}) {
+        size_t b = LatencyHistogram::bucket(v);
+        ASSERT_LT(b, LatencyHistogram::BUCKETS);
+        EXPECT_LE(LatencyHistogram::lower(b), v);
+        EXPECT_GE(LatencyHistogram::upper(b), v);
+        EXPECT_LE(LatencyHistogram::upper(b) - LatencyHistogram::lower(b), v / LatencyHistogram::SUB);
+    }
+
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 1000; ++v) h.record(v);
+    EXPECT_EQ(h.count, 1000u);
+    EXPECT_DOUBLE_EQ(h.mean(), 500.5);
+    EXPECT_NEAR(double(h.percentile(0.5)), 500, 500 / 8.0);
+    EXPECT_NEAR(double(h.percentile(0.99)), 990, 990 / 8.0);
+    EXPECT_GE(h.max(), 1000u);
+}
+
+TEST(MetricsTest, ThreadsAddUp) {
+    if (!metrics_enabled()) GTEST_SKIP() << "built without METRICS";
+    auto before = metrics_snapshot();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([] {
+            for (int i = 0; i < 100; ++i) {
+                METRIC_SCOPE(Timer::DrawMap);
+                METRIC_COUNT(Counter::Heals, 2);
+            }
+        });
+    for (auto &t : threads) t.join();
+
+    auto d = metrics_snapshot() - before;
+    EXPECT_EQ(d.timer(Timer::DrawMap).count, 400u);
+    EXPECT_EQ(d.counter(Counter::Heals), 800u);
+}
+
+TEST(MetricsTest, FinishedThreadsAreFoldedAndRecycled) {
+    if (!metrics_enabled()) GTEST_SKIP() << "built without METRICS";
+    auto before = metrics_snapshot();
+
+    std::thread([] { METRIC_COUNT(Counter::Escapes, 1); }).join();
+    size_t sets = metrics_thread_sets();
+    for (int i = 0; i < 50; ++i)
+        std::thread([] {
+            METRIC_COUNT(Counter::Escapes, 1);
+            METRIC_TIME(Timer::DrawMap, 1000);
+        }).join();
+
+    EXPECT_EQ(metrics_thread_sets(), sets);
+    auto d = metrics_snapshot() - before;
+    EXPECT_EQ(d.counter(Counter::Escapes), 51u);
+    EXPECT_EQ(d.timer(Timer::DrawMap).count, 50u);
+}
+
+TEST(MetricsTest, EngineReportsPhasesAndOutcomes) {
+    if (!metrics_enabled()) GTEST_SKIP() << "built without METRICS";
+    struct Kills : IInteractionObserver {
+        size_t n{0};
+        void on_interaction(const NPC&, const NPC&, InteractionOutcome) override {}
+        void on_batch(std::span<const InteractionRecord> ev) override { n += ev.size(); }
+    };
+    auto kills = std::make_shared<Kills>();
+    auto token = EventBus::instance().subscribe(kills, {.outcomes = EventFilter::bit(InteractionOutcome::TargetKilled)});
+
+    EngineConfig cfg;
+    cfg.tick_rate = 0;
+    cfg.max_x = 100;
+    cfg.max_y = 100;
+    Engine engine(cfg);
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 300; ++i) {
+        npcs.push_back(createNPC(static_cast<NPCType>(1 + i % 4), "N", rng().uniform(0, 100), rng().uniform(0, 100)));
+        engine.add(npcs.back());
+    }
+
+    auto before = metrics_snapshot();
+    engine.run_ticks(20);
+    auto d = metrics_snapshot() - before;
+    EventBus::instance().unsubscribe(token);
+
+    EXPECT_EQ(d.timer(Timer::Tick).count, 20u);
+    EXPECT_EQ(d.timer(Timer::Move).count, 20u);
+    EXPECT_EQ(d.timer(Timer::Observe).count, 20u);
+    EXPECT_EQ(d.counter(Counter::Events), engine.stats().pairs);
+    EXPECT_GT(kills->n, 0u);
+    EXPECT_EQ(d.counter(Counter::Kills), kills->n);
+
+    std::string report = format_metrics(d, 1.0);
+    EXPECT_NE(report.find("kills"), std::string::npos);
+    EXPECT_NE(report.find("resolve"), std::string::npos);
+}
+
 // ======================================================
 // MAIN
 // ======================================================
@@ -0,0 +1,80 @@
+#include "../include/event_log.h"
+#include "../include/game_utils.h"
+
+#include <iostream>
+#include <string>
+#include <cstring>
+
+// ---------------- Декодер двоичного журнала ----------------
+// log_decode <log.bin> [--csv]
+// По умолчанию печатает ту же таблицу, что пишет FileObserver.
+
+static const char* outcome_name(InteractionOutcome o) {
+    switch (o) {
+        case InteractionOutcome::TargetKilled:  return "killed";
+        case InteractionOutcome::TargetEscaped: return "escaped";
+        case InteractionOutcome::TargetHealed:  return "healed";
+        default:                                return "none";
+    }
+}
+
+static std::string csv_field(const std::string &s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string res = "\"";
+    for (char c : s) {
+        if (c == '"') res += '"';
+        res += c;
+    }
+    return res + "\"";
+}
+
+static void print_table(const EventLogContents &log) {
+    std::cout << FileObserver::table_header();
+
+    std::string line(256, '\0');
+    for (auto &ev : log.events) {
+        LogRow row{ev.actor, ev.actor_type, ev.ax, ev.ay,
+                   ev.target, ev.target_type, ev.tx, ev.ty, ev.outcome};
+        int n = FileObserver::format_row(line.data(), line.size(), row);
+        if (n <= 0) continue;
+        if (static_cast<size_t>(n) >= line.size()) {
+            line.resize(n + 1);
+            FileObserver::format_row(line.data(), line.size(), row);
+        }
+        std::cout.write(line.data(), n);
+    }
+}
+
+static void print_csv(const EventLogContents &log) {
+    std::cout << "time_us,actor,actor_type,actor_x,actor_y,outcome,target,target_type,target_x,target_y\n";
+    for (auto &ev : log.events) {
+        std::cout << ev.time_us << ','
+                  << csv_field(ev.actor) << ',' << type_to_string(ev.actor_type) << ','
+                  << ev.ax << ',' << ev.ay << ','
+                  << outcome_name(ev.outcome) << ','
+                  << csv_field(ev.target) << ',' << type_to_string(ev.target_type) << ','
+                  << ev.tx << ',' << ev.ty << '\n';
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3 || (argc == 3 && std::strcmp(argv[2], "--csv") != 0)) {
+        std::cerr << "usage: " << argv[0] << " <log.bin> [--csv]\n";
+        return 2;
+    }
+
+    EventLogContents log = read_event_log(argv[1]);
+    if (!log.ok) {
+        std::cerr << argv[1] << ": " << log.error << "\n";
+        return 1;
+    }
+
+    if (argc == 3) print_csv(log);
+    else           print_table(log);
+
+    if (log.bad_blocks)
+        std::cerr << "warning: " << log.bad_blocks << " block(s) failed checksum and were skipped\n";
+    if (log.unverified)
+        std::cerr << "warning: " << log.unverified << " trailing event(s) without checksum\n";
+    return log.bad_blocks ? 1 : 0;
+}